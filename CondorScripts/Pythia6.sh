@@ -8,6 +8,10 @@ OUTDIR=${RIVET_ANALYSIS_DIR}/HighStatsAida/Pythia6
 export LHAPATH=${RIVET_PREFIX}/local/share/lhapdf/PDFsets
 export AGILE_GEN_PATH=${RIVET_PREFIX}/local/generators 
 mkdir -p ${OUTDIR}
+# Resubmitted jobs replay the same seed and resume from the last checkpoint.
+# The events before it are generated again and only skipped by the analysis,
+# so a resubmission saves the analysis time, not the generation time.
+export JETSTUDY_CHECKPOINT=${OUTDIR}/Pythia6_tune${TUNE}_part${JOB_ID}
 source ${RIVET_PREFIX}/rivetenv.sh
 source ${RIVET_PREFIX}/agileenv.sh
 # do I need to add the TUNE code to the seed?
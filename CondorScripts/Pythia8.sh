@@ -2,17 +2,28 @@
 
 JOB_ID=$1
 TUNE=$2
+# Optional seed range, e.g. 13700-13715, generated in parallel on one node
+SEEDS=${3:-1370${JOB_ID}}
 RIVET_PREFIX=${HOME}/rivet
 RIVET_ANALYSIS_DIR=${RIVET_PREFIX}/Analysis/rivet-jet-charge
 OUTDIR=${RIVET_ANALYSIS_DIR}/HighStatsAida/Pythia8
 export LHAPATH=${HOME}/rivet/local/share/lhapdf/PDFsets
 mkdir -p ${OUTDIR}
+# Resubmitted jobs replay the same seed and resume from the last checkpoint.
+# The events before it are generated again and only skipped by the analysis,
+# so a resubmission saves the analysis time, not the generation time.
+# The event order depends on the seed range and JETSTUDY_THREADS (default
+# one thread per seed), keep both when resubmitting.
+export JETSTUDY_CHECKPOINT=${OUTDIR}/Pythia8_tune${TUNE}_part${JOB_ID}
+# Stop generating once these histograms reach 2% bin precision
+#export JETSTUDY_CONVERGENCE_HISTOS=WJetChargeK5,WJetChargeK3
+export JETSTUDY_CONVERGENCE_STOPFILE=/tmp/pythia8_converged_${JOB_ID}
 source ${RIVET_PREFIX}/rivetenv.sh
 source ${RIVET_PREFIX}/agileenv.sh
 cd ${RIVET_ANALYSIS_DIR}/MonteCarloParams/Pythia8/
-FIFONAME=/tmp/pythia8_fifo_${JOB_ID}.hepmc
-mkfifo ${FIFONAME}
 #cat wJetProd.cnf | sed "s/seed = 1234/seed = 1370${JOB_ID}/g" > wJetProd${JOB_ID}.cnf
 #cat wJetProd.cnf | sed "s/pp = 10/pp = ${TUNE}/g" > wJetProd${JOB_ID}.cnf
-./runPythia wJetProd.cnf ${FIFONAME} 1370${JOB_ID} ${TUNE} &
-rivet --analysis-path=${RIVET_ANALYSIS_DIR} -a MC_GENSTUDY_JETCHARGE --histo-file=${OUTDIR}/Pythia8_tune${TUNE}_part${JOB_ID}.aida ${FIFONAME}
+# Generation and analysis in one process, events are handed over in memory
+export RIVET_ANALYSIS_PATH=${RIVET_ANALYSIS_DIR}
+export LD_LIBRARY_PATH=${RIVET_ANALYSIS_DIR}:${LD_LIBRARY_PATH}
+./runPythiaRivet wJetProd.cnf ${OUTDIR}/Pythia8_tune${TUNE}_part${JOB_ID}.aida ${SEEDS} ${TUNE} MC_GENSTUDY_JETCHARGE
@@ -152,6 +152,12 @@ XLabel=$e^2$
 YLabel=$\int f(x) dx \equiv 1$ 
 # END PLOT
 
+# BEGIN PLOT /MC_GENSTUDY_JETCHARGE/(Down|Up|Strange|Charm|Bottom)JetCharge.*$
+Title= Jet charge $\times$ W charge ($Q_j Q_W$) by truth quark flavour
+XLabel=$e^2$
+YLabel=$\int f(x) dx \equiv 1$ 
+# END PLOT
+
 # BEGIN PLOT /MC_GENSTUDY_JETCHARGE/JetChargeVsWPt$
 Title= Jet charge ($Q_j Q_W$) vs $W p_\perp$
 XLabel=$e^2$
@@ -212,3 +218,21 @@ Title= N-subjettiness 2 Iteration
 XLabel=FIXME ($n$)
 YLabel=$\int f(x) dx \equiv 1$ 
 # END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JETCHARGE/ECF_C2$
+Title=Energy correlation ratio $C_2$ of Leading Jet
+XLabel=$C_2 = e_3 / e_2^2$
+YLabel=$\int f(x) dx \equiv 1$
+# END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JETCHARGE/ECF_D2$
+Title=Energy correlation ratio $D_2$ of Leading Jet
+XLabel=$D_2 = e_3 / e_2^3$
+YLabel=$\int f(x) dx \equiv 1$
+# END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JETCHARGE/ECF_C3$
+Title=Energy correlation ratio $C_3$ of Leading Jet
+XLabel=$C_3 = e_4 e_2 / e_3^2$
+YLabel=$\int f(x) dx \equiv 1$
+# END PLOT
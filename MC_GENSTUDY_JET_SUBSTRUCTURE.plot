@@ -160,6 +160,24 @@ RatioPlot=0
 Legend=0
 # END PLOT
 
+# BEGIN PLOT /MC_GENSTUDY_JET_SUBSTRUCTURE/averageasf_num
+Title=$\sum \Delta G$ numerator of the average ASF
+XLabel=$\Delta R$
+YLabel=$\sum \Delta G$
+LogY=0
+RatioPlot=0
+Legend=0
+# END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JET_SUBSTRUCTURE/averageasf_den
+Title=Normalisation of the average ASF
+XLabel=$\Delta R$
+YLabel=$\sum N$
+LogY=0
+RatioPlot=0
+Legend=0
+# END PLOT
+
 # BEGIN PLOT /MC_GENSTUDY_JET_SUBSTRUCTURE/1_peak_m
 Title=$n_p = 1$, $m_{*1}$
 XLabel=$m_{*1}$
@@ -276,3 +294,30 @@ LogY=0
 RatioPlot=0
 Legend=0
 # END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JET_SUBSTRUCTURE/ECF_C2
+Title=Energy correlation ratio $C_2$
+XLabel=$C_2 = e_3 / e_2^2$
+YLabel=Relative Occurence
+LogY=0
+RatioPlot=0
+Legend=0
+# END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JET_SUBSTRUCTURE/ECF_D2
+Title=Energy correlation ratio $D_2$
+XLabel=$D_2 = e_3 / e_2^3$
+YLabel=Relative Occurence
+LogY=0
+RatioPlot=0
+Legend=0
+# END PLOT
+
+# BEGIN PLOT /MC_GENSTUDY_JET_SUBSTRUCTURE/ECF_C3
+Title=Energy correlation ratio $C_3$
+XLabel=$C_3 = e_4 e_2 / e_3^2$
+YLabel=Relative Occurence
+LogY=0
+RatioPlot=0
+Legend=0
+# END PLOT
@@ -0,0 +1,81 @@
+//-*- C++ -*-
+
+#ifndef PYTHIASTREAMS_H
+#define PYTHIASTREAMS_H
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace Pythia8 { class Pythia; }
+namespace HepMC { class GenEvent; }
+
+/// "13701" or "13701-13717" (inclusive), false if malformed
+bool ParseSeedRange(const std::string& range, int& firstSeed, int& lastSeed);
+
+/// Several seeds of one Pythia 8 setup generated in parallel.
+///
+/// Every seed has its own Pythia instance. nThreads worker threads take
+/// the seeds in order, each starting the next one as soon as it is done
+/// with the last. Instances are set up and initialised on the workers, so
+/// the inits overlap, but nothing is shared between them: every seed still
+/// pays its own init and PDF load. next() hands out the events round-robin
+/// over a window of nThreads seeds (first event of every seed, then the
+/// second, ...); when a seed runs out, the next seed in order takes its
+/// place. The merged stream thus depends on the seed range, the thread
+/// count and the events of each seed only, never on timing. Every event carries its seed as
+/// its first HepMC random state and its number within that seed as event
+/// number, so the per-seed sequences, identical to single seed runs, can be
+/// recovered. Main:numberOfEvents applies per seed. A checkpointed job
+/// must be resumed with the same seed range and thread count.
+///
+/// LHAPDF is not thread safe; a setup using it runs one seed at a time.
+class PythiaStreams {
+public:
+  /// nThreads 0 means one per seed, whatever the number of cores
+  PythiaStreams(const std::string& configFile, int firstSeed, int lastSeed,
+                const std::string& tune, unsigned int nThreads, unsigned int queueSize);
+  ~PythiaStreams();
+
+  /// Next event in merged order, 0 when every seed is done. The caller owns it.
+  HepMC::GenEvent* next();
+  /// Stop generating, e.g. once the analyses have converged
+  void stop();
+
+  unsigned int nThreads() const { return _nThreads; }
+  /// Events handed out by next()
+  long nEvents() const { return _nEvents; }
+  /// sigmaGen of the finished seeds, weighted by their events, in mb
+  double sigmaGen() const { return _sigmaEvents > 0 ? _sigmaSum/_sigmaEvents : 0.; }
+
+  struct Stream;
+
+private:
+  PythiaStreams(const PythiaStreams&);
+  PythiaStreams& operator=(const PythiaStreams&);
+
+  /// Thread function of the workers
+  static void* work(void* self);
+  /// Next seed to generate, 0 when there are none or generation stopped
+  Stream* takeSeed();
+  /// Set up the instance of the seed for generation
+  void initialise(Stream& stream) const;
+  /// Print the statistics of a seed and free its instance
+  void finishStream(Stream& stream);
+
+  std::string _configFile;
+  std::string _tune;
+  unsigned int _nThreads;
+  /// Every seed, in order
+  std::vector<Stream*> _streams;
+  std::vector<pthread_t> _threads;
+  /// Guards _nextStart and _stopped for the workers
+  pthread_mutex_t _mutex;
+  unsigned int _nextStart;
+  bool _stopped;
+  /// Round-robin window of next(), and the next seed to enter it
+  std::vector<Stream*> _active;
+  unsigned int _cursor, _nextMerge;
+  long _nEvents;
+  double _sigmaSum, _sigmaEvents;
+};
+#endif
@@ -0,0 +1,121 @@
+//-*- C++ -*-
+
+#ifndef RIVET_AnalysisCheckpoint_HH
+#define RIVET_AnalysisCheckpoint_HH
+#include <string>
+#include <vector>
+#include <ctime>
+#include <pthread.h>
+#include "Rivet/RivetAIDA.hh"
+#include "RunningMoments.h"
+namespace LWH { class Histogram1D; }
+namespace Rivet{
+  /// Periodic checkpoint of an analysis' state so preempted jobs can resume.
+  ///
+  /// Enabled by JETSTUDY_CHECKPOINT=<prefix>, the state is written to
+  /// <prefix>.<analysis>.ckpt every JETSTUDY_CHECKPOINT_EVENTS events or
+  /// JETSTUDY_CHECKPOINT_SECONDS seconds, whichever comes first.  The
+  /// event loop only copies bin contents; formatting and writing happens on
+  /// a background thread.  On restart the generator replays the same seed,
+  /// so the first N events are skipped instead of analysed twice.  The
+  /// generator state is not saved, those N events are still generated;
+  /// only their analysis time is saved.
+  class AnalysisCheckpoint {
+  public:
+    AnalysisCheckpoint();
+    ~AnalysisCheckpoint();
+
+    /// Read the options, false if checkpointing is switched off
+    bool configure(const std::string& analysisName);
+    bool enabled() const { return _enabled; }
+
+    /// Register state to be saved, call before restore(). Histograms must
+    /// be LWH ones, as booked by Rivet and jetstudyrun.
+    void addHistogram(const std::string& name, AIDA::IHistogram1D* histo);
+    void addCounter(const std::string& name, int* counters, unsigned int n=1);
+    void addMoments(const std::string& name, MomentSet* moments);
+
+    /// Load the last checkpoint into the registered objects, if there is one
+    bool restore();
+
+    /// Call first thing in analyze(). Returns false for events which were
+    /// already analysed before the restart, these must be vetoed.
+    bool nextEvent();
+
+    /// Write the final state and stop the writer, call before normalising
+    void finish();
+
+    /// Number of events seen, including restored ones
+    unsigned long eventCount() const { return _seen; }
+
+    /// Per-bin sums as LWH keeps them, index 0 and 1 are the under- and
+    /// overflow
+    struct BinState {
+      int entries;
+      double sumw;
+      double sumw2;
+      double sumxw;
+      double sumx2w;
+    };
+    struct HistoState {
+      std::string name;
+      std::vector<BinState> bins;
+    };
+    struct CounterState {
+      std::string name;
+      std::vector<int> values;
+    };
+    /// One quantity of a registered MomentSet
+    struct MomentState {
+      std::string set;
+      std::string name;
+      long entries;
+      double sumw;
+      double sumw2;
+      double mean;
+      double m2;
+    };
+    struct Snapshot {
+      std::string analysis;
+      unsigned long events;
+      std::vector<CounterState> counters;
+      std::vector<HistoState> histos;
+      std::vector<MomentState> moments;
+    };
+
+  private:
+    AnalysisCheckpoint(const AnalysisCheckpoint&);
+    AnalysisCheckpoint& operator=(const AnalysisCheckpoint&);
+
+    void takeSnapshot(Snapshot& snap, unsigned long events) const;
+    void queueSnapshot();
+    static void* writerLoop(void* self);
+    bool write(const Snapshot& snap) const;
+    bool read(Snapshot& snap) const;
+
+    bool _enabled;
+    std::string _analysis;
+    std::string _fileName;
+    unsigned long _everyEvents;
+    double _everySeconds;
+
+    std::vector<std::pair<std::string, LWH::Histogram1D*> > _histos;
+    std::vector<std::pair<std::string, std::pair<int*, unsigned int> > > _counters;
+    std::vector<std::pair<std::string, MomentSet*> > _moments;
+
+    unsigned long _seen;
+    unsigned long _skip;
+    unsigned long _lastEvents;
+    time_t _lastTime;
+
+    /// Hand-over between the event loop and the writer thread
+    pthread_t _writer;
+    bool _writerRunning;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    Snapshot _pending;
+    bool _hasPending;
+    bool _stop;
+  };
+}
+#endif
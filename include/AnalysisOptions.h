@@ -0,0 +1,41 @@
+//-*- C++ -*-
+
+#ifndef RIVET_AnalysisOptions_HH
+#define RIVET_AnalysisOptions_HH
+#include <cstdlib>
+#include <string>
+#include <vector>
+namespace Rivet{
+  /// Run-time options for the study analyses. Rivet 1 has no way to pass
+  /// options to an analysis, so they are read from JETSTUDY_* environment
+  /// variables which the Condor scripts can set per job.
+  inline std::string OptionString(const std::string& name, const std::string& def="") {
+    const char* value = std::getenv(("JETSTUDY_" + name).c_str());
+    return (value && *value) ? std::string(value) : def;
+  }
+
+  inline double OptionDouble(const std::string& name, double def) {
+    const std::string value = OptionString(name);
+    return value.empty() ? def : std::atof(value.c_str());
+  }
+
+  inline long OptionInt(const std::string& name, long def) {
+    const std::string value = OptionString(name);
+    return value.empty() ? def : std::atol(value.c_str());
+  }
+
+  /// Comma separated list option, e.g. JETSTUDY_FOO="a,b,c"
+  inline std::vector<std::string> OptionList(const std::string& name, const std::string& def="") {
+    std::vector<std::string> items;
+    const std::string value = OptionString(name, def);
+    size_t start = 0;
+    while (start <= value.size() && !value.empty()) {
+      size_t end = value.find(',', start);
+      if (end == std::string::npos) end = value.size();
+      if (end > start) items.push_back(value.substr(start, end - start));
+      start = end + 1;
+    }
+    return items;
+  }
+}
+#endif
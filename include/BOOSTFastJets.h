@@ -3,6 +3,9 @@
 #ifndef RIVET_BOOSTFastJets_HH
 #define RIVET_BOOSTFastJets_HH
 #include "Rivet/Projections/FastJets.hh"
+#include "ScratchArena.h"
+#include "KernelMath.h"
+#include <iosfwd>
 namespace Rivet{
   /// structs used in angular correlation calculations
   struct ACFparticlepair {
@@ -25,12 +28,110 @@ namespace Rivet{
     double Rval;
     double value;
   };
+  /// A jet passing the selection, with everything the observables need.
+  /// Built once per event so the constituents and the matching Rivet
+  /// particles (same order) are not extracted again for every observable.
+  struct SelectedJet {
+    fastjet::PseudoJet pseudoJet;
+    PseudoJets constituents;
+    ParticleVector particles;
+    /// Sum of the particle momenta, as Jet::momentum()
+    FourMomentum momentum;
+  };
+  typedef vector<SelectedJet> SelectedJets;
+
+  /// The (at most maxJets) highest pT jets above ptmin with mmin < m < mmax.
+  /// Needs the particles() accessor from BOOSTFastJets.patch.
+  void SelectJets(const FastJets& jetProjection, double ptmin, double mmin, double mmax,
+		  unsigned int maxJets, SelectedJets& selected);
+
+  /// The same selection on jets from any source, e.g. MultiRadiusJets
+  void SelectJets(const FastJets& jetProjection, const PseudoJets& candidates, double mmin, double mmax,
+		  unsigned int maxJets, SelectedJets& selected);
+
+  /// Cambridge/Aachen jets for several radii from one clustering.
+  ///
+  /// C/A merges pairs in order of increasing delta R whatever the radius,
+  /// so the inclusive jets of radius R are exactly the exclusive jets at
+  /// dcut = (R/Rmax)^2 of a clustering with Rmax. One FastJets::CAM
+  /// projection at maxRadius() thus serves the whole R scan, each further
+  /// radius only costs a walk through the clustering history.
+  class MultiRadiusJets {
+  public:
+    /// Radii from JETSTUDY_<tag>_RADII, e.g. "0.4,0.6,1.0". Off if empty.
+    void configure(const std::string& tag);
+    void setRadii(const vector<double>& radii);
+    bool enabled() const { return !_radii.empty(); }
+    unsigned int size() const { return _radii.size(); }
+    double radius(unsigned int i) const { return _radii[i]; }
+    double maxRadius() const { return _radii.empty() ? 0. : _radii.back(); }
+    /// Histogram name suffix for radius i, e.g. "_R06"
+    std::string suffix(unsigned int i) const;
+
+    /// Jets of radius(i) above ptmin, hardest first. camJets must be a
+    /// FastJets::CAM projection with R = maxRadius().
+    void jets(const FastJets& camJets, unsigned int i, double ptmin, PseudoJets& out) const;
+  private:
+    /// Ascending
+    vector<double> _radii;
+  };
+
+  /// Pull, jet charge and dipolarity of one jet for an ascending list of
+  /// constituent pT thresholds, in one pass.
+  ///
+  /// The constituents are sorted by pT once and the per-constituent terms
+  /// of each observable summed from the hardest down. Every threshold then
+  /// reads its sums off these suffix sums, so T thresholds cost
+  /// O(n log n + T) instead of T calls of JetPull() and JetCharge(). The
+  /// results are those of the single-threshold functions, bugs included,
+  /// up to the order of summation: pT > ptmin for the pull, pT >= ptmin
+  /// for the charge, and pT > ptmin for the dipolarity, which has no cut
+  /// of its own.
+  class ThresholdScan {
+  public:
+    /// Thresholds in GeV from JETSTUDY_<tag>_PTMIN_SCAN, e.g. "0.5,1,2".
+    /// Off if empty.
+    void configure(const std::string& tag);
+    void setThresholds(const vector<double>& thresholds);
+    bool enabled() const { return !_thresholds.empty(); }
+    unsigned int size() const { return _thresholds.size(); }
+    double threshold(unsigned int i) const { return _thresholds[i]; }
+    /// Histogram name suffix for threshold i, e.g. "_PT05" for 0.5 GeV
+    std::string suffix(unsigned int i) const;
+
+    /// Scan jet j of jetProjection, with the charge for every exponent
+    /// of kappas
+    void compute(const FastJets& jetProjection, const fastjet::PseudoJet& j, const vector<double>& kappas);
+    /// Results of the last compute() at threshold i, as JetPull(),
+    /// JetCharge() for kappas[ik] and Dipolarity()
+    const std::pair<double,double>& pull(unsigned int i) const { return _pull[i]; }
+    double charge(unsigned int ik, unsigned int i) const { return _charge[ik*_thresholds.size() + i]; }
+    double dipolarity(unsigned int i) const { return _dipolarity[i]; }
+  private:
+    /// Ascending, in GeV
+    vector<double> _thresholds;
+    vector<std::pair<double,double> > _pull;
+    vector<double> _charge, _dipolarity;
+  };
+
   /// Calculate Dipolarity of Jet
   double Dipolarity(const fastjet::PseudoJet &j);
   // Calculate Pull of Jet
   std::pair<double,double> JetPull(const FastJets& jetProjection,const fastjet::PseudoJet &j, const double ptmin=-1*GeV);
+  /// Pull from the jet's constituents, no projection needed
+  std::pair<double,double> JetPull(const fastjet::PseudoJet &j, const PseudoJets& constituents, const double ptmin=-1*GeV);
   /// Calculate JetCharge
   double JetCharge(const FastJets& jetProjection,const fastjet::PseudoJet &j, const double k=0.5, const double ptmin=-1*GeV);
+  /// JetCharge from the constituents and their charges (same order)
+  double JetCharge(const fastjet::PseudoJet &j, const PseudoJets& constituents, const double* charges,
+		   const double k=0.5, const double ptmin=-1*GeV);
+  /// The jet charge kernels at a given precision, float or double; the
+  /// functions above use KernelReal
+  template <typename Real>
+  double JetCharge(const FastJets& jetProjection,const fastjet::PseudoJet &j, const double k=0.5, const double ptmin=-1*GeV);
+  template <typename Real>
+  double JetCharge(const fastjet::PseudoJet &j, const PseudoJets& constituents, const double* charges,
+		   const double k=0.5, const double ptmin=-1*GeV);
 
   fastjet::JetAlgorithm setJetAlgorithm(FastJets::JetAlgName subJetAlgorithm);
   /// Create a filter, run it over specified jet
@@ -51,23 +152,168 @@ namespace Rivet{
   /// Get N=n_jets subjets to be used for finding N-subjettiness
   /// Thaler, Van Tilburg, arXiv:1011.2268
   PseudoJets GetAxes(const fastjet::ClusterSequence* clusterSeq, unsigned int n_jets,
-		     PseudoJets& inputJets, FastJets::JetAlgName subjet_def, double subR);
+		     const PseudoJets& inputJets, FastJets::JetAlgName subjet_def, double subR);
 
   /// Get the N-subjettiness with respect to the subjet axes.
   /// Thaler, Van Tilburg, arXiv:1011.2268
   double TauValue(double beta, double jet_rad,
-		  PseudoJets& particles, PseudoJets& axes);
+		  const PseudoJets& particles, const PseudoJets& axes);
+  /// The same at a given precision, float or double
+  template <typename Real>
+  double TauValue(double beta, double jet_rad,
+		  const PseudoJets& particles, const PseudoJets& axes);
 
   /// Update axes towards Tau(y, phi) minimum.
   /// Thaler, Van Tilburg, arxiv:1108.2701
   void UpdateAxes(double beta,
-		  PseudoJets& particles, PseudoJets& axes);
+		  const PseudoJets& particles, PseudoJets& axes);
+
+  /// Pairwise distances of a jet's constituents, computed once and shared
+  /// by the ASF and the energy correlation functions. Particles are
+  /// ordered by decreasing pT, distances are sqrt(dy^2 + dphi^2) as
+  /// PseudoJet::plain_distance(). Lives in the thread's scratch arena.
+  class JetPairCache {
+  public:
+    explicit JetPairCache(const PseudoJets& particles);
+    unsigned int size() const { return _pt.size(); }
+    double pt(unsigned int i) const { return _pt[i]; }
+    double deltaR(unsigned int i, unsigned int j) const { return _dR[i*_pt.size() + j]; }
+    /// Row i of the symmetric distance matrix
+    const double* row(unsigned int i) const { return &_dR[i*_pt.size()]; }
+  private:
+    ScratchVector<double>::type _pt;
+    ScratchVector<double>::type _dR;
+  };
+
+  /// Normalised energy correlation functions and their ratios
+  /// Larkoski, Salam, Thaler, arXiv:1305.0007; Larkoski, Moult, Neill, arXiv:1409.6298
+  struct ECFResult {
+    /// e_N = sum over N-tuples of prod z_i prod dR_ij^beta, z_i = pT_i/sum pT
+    double e2, e3, e4;
+    /// Upper bounds on what the truncation to the leading particles left out
+    double e2Error, e3Error, e4Error;
+    /// C2 = e3/e2^2, D2 = e3/e2^3, C3 = e4 e2/e3^2, zero where undefined
+    double C2, D2, C3;
+  };
+
+  /// Default of JETSTUDY_ECF_MAXN: e4 over 40 particles is about 1e5
+  /// quadruplets, where a full R=1.2 jet of 400 would be about 1e9
+  const unsigned int ECFDefaultMaxN = 40;
+
+  /// Energy correlation functions up to N=4, all summed over the maxN
+  /// hardest particles, 0 for all of them. z_i stays the fraction of the
+  /// full jet pT, so the truncated e_N only miss N-tuples with a softer
+  /// particle; e2Error, e3Error and e4Error bound that part.
+  ECFResult EnergyCorrelations(const JetPairCache& cache, double beta = 1.,
+			       unsigned int maxN = ECFDefaultMaxN);
+
+  class MomentSet;
+
+  /// Mean of the truncation bounds filled as ECF_e2Error, ECF_e3Error and
+  /// ECF_e4Error, next to the mean e_N (ECF_e2, ...) they are to be read
+  /// against
+  void PrintECFTruncation(std::ostream& os, const MomentSet& moments, unsigned int maxN);
+
+  /// Limits for ThinConstituents
+  struct ThinningSettings {
+    /// Largest fraction of the jet's scalar pT that may be merged
+    double budget;
+    /// Soft particles closer than this to a cluster are merged into it
+    double mergeR;
+    /// Jets with at most this many constituents are left alone, thinning
+    /// stops once a jet is down to it
+    unsigned int threshold;
+  };
+
+  struct ThinningReport {
+    unsigned int before;
+    unsigned int after;
+    /// Fraction of the scalar pT that went into merged clusters
+    double mergedFraction;
+  };
+
+  /// Merge the softest constituents of large jets into small delta R
+  /// clusters (E-scheme sums) until the jet is down to the threshold or the
+  /// pT budget is used up. Meant for the O(n^2) and O(n^3) pair based
+  /// observables only; out holds the untouched harder particles followed by
+  /// the clusters.
+  ThinningReport ThinConstituents(const PseudoJets& in, PseudoJets& out, const ThinningSettings& settings);
+
+  /// Per-analysis thinning mode and its bookkeeping.
+  ///
+  /// Configured by JETSTUDY_<tag>_THIN_BUDGET (0, i.e. off, by default),
+  /// _THIN_R (0.1) and _THIN_ABOVE (100 constituents).  With
+  /// JETSTUDY_<tag>_THIN_VALIDATE=1 the analysis also evaluates observables
+  /// on the full jet and hands both values to compare(), and the largest
+  /// change per observable is printed at the end.
+  class ConstituentThinning {
+  public:
+    ConstituentThinning();
+    void configure(const std::string& tag);
+    bool enabled() const { return _settings.budget > 0.; }
+    bool validating() const { return enabled() && _validate; }
+
+    /// The constituents to use for pair based observables, the input
+    /// itself for jets below the threshold
+    const PseudoJets& apply(const PseudoJets& constituents);
+    /// Whether the last apply() changed the jet
+    bool thinned() const { return _thinned; }
+
+    /// Record the change of an observable induced by the last thinning
+    void compare(const std::string& observable, double thinnedValue, double fullValue);
+
+    void print(std::ostream& os, const std::string& analysis) const;
+
+  private:
+    ThinningSettings _settings;
+    bool _validate;
+    bool _thinned;
+    PseudoJets _output;
+    unsigned long _jets, _thinnedJets, _before, _after;
+    double _maxFraction;
+    std::map<std::string, double> _maxChange;
+  };
+
+  /// Check of the float kernels against the double ones.
+  ///
+  /// In a float build (make PRECISION=float) with
+  /// JETSTUDY_PRECISION_VALIDATE=1 the analyses evaluate the templated
+  /// kernels in double as well and hand both values to compare(). The
+  /// largest deviation per histogram is printed at the end in units of the
+  /// histogram's bin width, flagged where it exceeds
+  /// JETSTUDY_PRECISION_TOLERANCE (0.1 bins by default).
+  class PrecisionCheck {
+  public:
+    PrecisionCheck();
+    void configure();
+    bool enabled() const { return _validate; }
+
+    void compare(const std::string& histogram, double binWidth, double value, double reference);
+    /// Largest deviation of all histograms, in bin widths
+    double maxDeviation() const;
+
+    void print(std::ostream& os, const std::string& analysis) const;
+
+  private:
+    bool _requested, _validate;
+    double _tolerance;
+    unsigned long _compared;
+    std::map<std::string, double> _maxDeviation;
+  };
 
   /// Find peaks in Angular Structure Function for the given particles
   /// Jankowiak, Larkowski, arxiv:1104.1646
   /// Based on code by Jankowiak and Larkowski
   /// Normalisation: 0 - error function, else step function
-  vector<ACFpeak> ASFPeaks(PseudoJets& particles,
+  vector<ACFpeak> ASFPeaks(const PseudoJets& particles,
+			   unsigned int most_prominent = 0, double minprominence = 0.0,
+			   double sigma = 0.06, unsigned int meshsize = 500, unsigned int normalisation = 0);
+  vector<ACFpeak> ASFPeaks(const JetPairCache& cache,
+			   unsigned int most_prominent = 0, double minprominence = 0.0,
+			   double sigma = 0.06, unsigned int meshsize = 500, unsigned int normalisation = 0);
+  /// The same with the mesh loop at a given precision, float or double
+  template <typename Real>
+  vector<ACFpeak> ASFPeaks(const JetPairCache& cache,
 			   unsigned int most_prominent = 0, double minprominence = 0.0,
 			   double sigma = 0.06, unsigned int meshsize = 500, unsigned int normalisation = 0);
 
@@ -75,10 +321,22 @@ namespace Rivet{
   /// and the normalisation function depending on the normalisation variable ([2])
   /// Mainly used for average angular structure function.
   /// Jankowiak, Larkowski, arXiv:1201.2688
-  vector<vector<double> > ASF(PseudoJets& particles,
+  vector<vector<double> > ASF(const PseudoJets& particles,
+                double sigma = 0.06, unsigned int meshsize = 500, unsigned int normalisation = 0);
+  vector<vector<double> > ASF(const JetPairCache& cache,
                 double sigma = 0.06, unsigned int meshsize = 500, unsigned int normalisation = 0);
+  template <typename Real>
+  vector<vector<double> > ASF(const JetPairCache& cache,
+                double sigma = 0.06, unsigned int meshsize = 500, unsigned int normalisation = 0);
+
+  double KeyColToRight(int p, const vector<ACFpeak>& peaks, const double* ASF_erf);
+  double KeyColToLeft(int p, const vector<ACFpeak>& peaks, const double* ASF_erf);
 
-  double KeyColToRight(int p, vector<ACFpeak> peaks, vector<double> ASF_erf);
-  double KeyColToLeft(int p, vector<ACFpeak> peaks, vector<double> ASF_erf);
+  /// Upper bound on the scalar pT sum of the particles within any (y, phi)
+  /// disc of radius R, from a grid of calorimeter-like towers. Cheap enough
+  /// to veto events before clustering. Only a heuristic for the jet pT:
+  /// anti-kt jets are usually cones of radius R, but may take in particles
+  /// beyond it, so a jet can be harder than this bound.
+  double MaxConePt(const ParticleVector& particles, double R, double yMax, double cellSize = 0.1);
 }
 #endif
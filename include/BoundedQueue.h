@@ -0,0 +1,74 @@
+//-*- C++ -*-
+
+#ifndef RIVET_BoundedQueue_HH
+#define RIVET_BoundedQueue_HH
+#include <deque>
+#include <pthread.h>
+namespace Rivet{
+  /// Fixed capacity FIFO between producer and consumer threads.
+  ///
+  /// push() blocks while the queue is full, so a fast generator cannot run
+  /// ahead of the analysis by more than the capacity; pop() blocks while it
+  /// is empty. After close() pushes are refused and pop() drains what is
+  /// left, then returns false.
+  template <typename T>
+  class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity) : _capacity(capacity ? capacity : 1), _closed(false) {
+      pthread_mutex_init(&_mutex, 0);
+      pthread_cond_init(&_notFull, 0);
+      pthread_cond_init(&_notEmpty, 0);
+    }
+    ~BoundedQueue() {
+      pthread_cond_destroy(&_notEmpty);
+      pthread_cond_destroy(&_notFull);
+      pthread_mutex_destroy(&_mutex);
+    }
+
+    /// False if the queue was closed, the item is then not queued
+    bool push(const T& item) {
+      pthread_mutex_lock(&_mutex);
+      while (_items.size() >= _capacity && !_closed) pthread_cond_wait(&_notFull, &_mutex);
+      const bool accepted = !_closed;
+      if (accepted) _items.push_back(item);
+      pthread_mutex_unlock(&_mutex);
+      if (accepted) pthread_cond_signal(&_notEmpty);
+      return accepted;
+    }
+
+    /// False once the queue is closed and empty
+    bool pop(T& item) {
+      pthread_mutex_lock(&_mutex);
+      while (_items.empty() && !_closed) pthread_cond_wait(&_notEmpty, &_mutex);
+      const bool got = !_items.empty();
+      if (got) {
+        item = _items.front();
+        _items.pop_front();
+      }
+      pthread_mutex_unlock(&_mutex);
+      if (got) pthread_cond_signal(&_notFull);
+      return got;
+    }
+
+    /// No more items, wakes up every waiting thread
+    void close() {
+      pthread_mutex_lock(&_mutex);
+      _closed = true;
+      pthread_mutex_unlock(&_mutex);
+      pthread_cond_broadcast(&_notFull);
+      pthread_cond_broadcast(&_notEmpty);
+    }
+
+  private:
+    BoundedQueue(const BoundedQueue&);
+    BoundedQueue& operator=(const BoundedQueue&);
+
+    const size_t _capacity;
+    bool _closed;
+    std::deque<T> _items;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _notFull;
+    pthread_cond_t _notEmpty;
+  };
+}
+#endif
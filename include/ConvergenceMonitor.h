@@ -0,0 +1,63 @@
+//-*- C++ -*-
+
+#ifndef RIVET_ConvergenceMonitor_HH
+#define RIVET_ConvergenceMonitor_HH
+#include <string>
+#include <vector>
+#include "Rivet/RivetAIDA.hh"
+namespace Rivet{
+  /// Online check of the statistical precision of key histograms.
+  ///
+  /// JETSTUDY_CONVERGENCE_HISTOS lists the histograms to watch, e.g.
+  /// "WJetChargeK5,Tau_32,Filtered_mass".  Every
+  /// JETSTUDY_CONVERGENCE_CHECK events the relative error of each bin holding
+  /// at least JETSTUDY_CONVERGENCE_MINFRACTION of the tallest bin is compared
+  /// to JETSTUDY_CONVERGENCE_PRECISION.  Once all monitors in the process
+  /// have converged, the file JETSTUDY_CONVERGENCE_STOPFILE is created; the
+  /// generator driver polls for it and stops producing events.
+  class ConvergenceMonitor {
+  public:
+    ConvergenceMonitor();
+    ~ConvergenceMonitor();
+
+    /// Read the options, false if no histograms are to be watched
+    bool configure(const std::string& analysisName);
+    bool enabled() const { return _enabled; }
+
+    /// Watch this histogram if it is in the configured list
+    void addHistogram(const std::string& name, AIDA::IHistogram1D* histo);
+
+    /// Take part in the stop decision, call after the last addHistogram()
+    void start();
+
+    /// Call once per analysed event
+    void update();
+
+    /// Worst relative error over the watched histograms
+    double precision() const { return _precision; }
+    bool converged() const;
+
+    /// True once every monitor watching something has converged
+    static bool allConverged();
+
+  private:
+    ConvergenceMonitor(const ConvergenceMonitor&);
+    ConvergenceMonitor& operator=(const ConvergenceMonitor&);
+
+    double relativeError(const AIDA::IHistogram1D* histo) const;
+    bool watching() const { return !_histos.empty(); }
+
+    bool _enabled;
+    std::string _analysis;
+    std::vector<std::string> _names;
+    std::vector<std::pair<std::string, AIDA::IHistogram1D*> > _histos;
+    double _target;
+    double _minFraction;
+    unsigned long _checkEvery;
+    unsigned long _events;
+    double _precision;
+    /// Read by allConverged() from other threads, under gMonitorsMutex
+    bool _converged;
+  };
+}
+#endif
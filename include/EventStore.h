@@ -0,0 +1,161 @@
+//-*- C++ -*-
+
+#ifndef EVENTSTORE_HH
+#define EVENTSTORE_HH
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace HepMC { class GenEvent; }
+
+/// Compact binary event files ("jcev") for replaying generator output.
+///
+/// Only what the analyses read is kept: the beams, all final state
+/// particles and the partons (quarks and gluons of any status, for truth
+/// matching), plus the event weights. Events are grouped in blocks, each
+/// stored column by column (all px of the block, then all py, ...) and
+/// zlib compressed on its own.
+///
+/// Layout, all numbers in the byte order of the machine which wrote the
+/// file; byteOrder tells a reader on a machine of the other order to
+/// refuse it:
+///   header   : FileHeader
+///   blocks   : compressed blocks, back to back
+///   names    : null terminated weight names
+///   index    : nBlocks x BlockEntry, by first event
+/// Uncompressed block, n events and p particles in total:
+///   n x int32 event number, n x int32 process id, n x uint32 particles,
+///   n x uint32 weights, sum(weights) x double,
+///   p x px, py, pz, e (double, or float and mass instead of e with
+///   kSinglePrecision), p x int32 pdg id, p x int16 status
+/// A Reader maps the file and decompresses one block at a time.
+namespace EventStore {
+  enum Flags {
+    /// Momenta as float, with the mass instead of the energy so light
+    /// particles keep their mass
+    kSinglePrecision = 1
+  };
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    /// kByteOrder as written, reads back swapped on the other byte order
+    uint32_t byteOrder;
+    uint32_t reserved;
+    uint64_t nEvents;
+    uint64_t nBlocks;
+    uint64_t namesOffset;
+    uint64_t nNames;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+  };
+
+  struct BlockEntry {
+    uint64_t offset;
+    uint64_t compressedSize;
+    uint64_t rawSize;
+    uint64_t firstEvent;
+    uint32_t nEvents;
+    uint32_t nParticles;
+  };
+
+  /// One event of a decompressed block, valid until the Reader moves to
+  /// another block. Beam particles have status 4.
+  struct EventView {
+    int eventNumber;
+    int processId;
+    unsigned int nParticles;
+    const double* px;
+    const double* py;
+    const double* pz;
+    const double* e;
+    const int32_t* pdgId;
+    const int16_t* status;
+    unsigned int nWeights;
+    const double* weights;
+  };
+
+  /// Whether the writer keeps this particle
+  bool Keep(int pdgId, int status);
+
+  class Writer {
+  public:
+    explicit Writer(unsigned int eventsPerBlock = 256, uint32_t flags = 0, int level = 6);
+    ~Writer();
+    bool open(const std::string& fileName);
+    /// Store the kept particles of this event
+    bool write(const HepMC::GenEvent& event);
+    /// Flush the last block and write the index, the file is unusable without
+    bool close();
+    uint64_t nEvents() const { return _nEvents; }
+  private:
+    Writer(const Writer&);
+    Writer& operator=(const Writer&);
+    bool flush();
+
+    unsigned int _eventsPerBlock;
+    uint32_t _flags;
+    int _level;
+    std::FILE* _file;
+    uint64_t _nEvents;
+    uint64_t _offset;
+    std::vector<BlockEntry> _index;
+    std::vector<std::string> _weightNames;
+    //columns of the current block
+    std::vector<int32_t> _eventNumber, _processId;
+    std::vector<uint32_t> _nParticles, _nWeights;
+    std::vector<double> _weights;
+    std::vector<double> _px, _py, _pz, _e;
+    std::vector<int32_t> _pdgId;
+    std::vector<int16_t> _status;
+  };
+
+  class Reader {
+  public:
+    Reader();
+    ~Reader();
+    bool open(const std::string& fileName);
+    void close();
+    bool isOpen() const { return _base != 0; }
+    uint64_t size() const;
+    const std::vector<std::string>& weightNames() const { return _weightNames; }
+    /// Event i, decompressing its block if needed; sequential reading
+    /// decompresses each block once
+    bool event(uint64_t i, EventView& view);
+    /// Event i as a HepMC event with a single vertex (beams in, the rest
+    /// out), enough for Rivet. The caller owns it, 0 on error.
+    HepMC::GenEvent* genEvent(uint64_t i);
+  private:
+    Reader(const Reader&);
+    Reader& operator=(const Reader&);
+    bool validate() const;
+    bool loadBlock(unsigned int block);
+
+    const char* _base;
+    size_t _length;
+    const FileHeader* _header;
+    const BlockEntry* _index;
+    std::vector<std::string> _weightNames;
+    int _block;
+    std::vector<char> _raw;
+    //columns of the current block, pointing into _raw or, for single
+    //precision files, into the unpacked momenta
+    const int32_t* _eventNumber;
+    const int32_t* _processId;
+    const double* _weights;
+    const double* _px;
+    const double* _py;
+    const double* _pz;
+    const double* _e;
+    const int32_t* _pdgId;
+    const int16_t* _status;
+    std::vector<unsigned int> _first, _firstWeight;
+    std::vector<double> _unpacked;
+  };
+
+  /// Convert between ASCII HepMC and jcev, by file extension
+  bool Convert(const std::string& in, const std::string& out, uint32_t flags = 0);
+}
+#endif
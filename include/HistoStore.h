@@ -0,0 +1,102 @@
+//-*- C++ -*-
+
+#ifndef HISTOSTORE_HH
+#define HISTOSTORE_HH
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/// Indexed binary histogram store ("hbin" files).
+///
+/// Layout, all numbers in the byte order of the machine which wrote the
+/// file, so the bins can be used in place; byteOrder tells a reader on a
+/// machine of the other order to refuse it:
+///   header   : FileHeader
+///   index    : nHistos x IndexEntry, sorted by path
+///   strings  : null terminated paths and titles
+///   data     : nBins x StoredBin per histogram, 8 byte aligned
+/// A Reader maps the file and hands out one histogram at a time without
+/// touching the rest, so pulling a few plots out of a large AIDA output
+/// costs one binary search and a page fault.
+namespace HistoStore {
+  /// One data point, same content as an AIDA <dataPoint> of dimension 2
+  struct StoredBin {
+    double x;
+    double xErrMinus;
+    double xErrPlus;
+    double y;
+    double yErrMinus;
+    double yErrPlus;
+  };
+
+  /// Histogram as parsed from an AIDA file
+  struct Histogram {
+    std::string path;
+    std::string title;
+    std::vector<StoredBin> bins;
+  };
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nHistos;
+    /// kByteOrder as written, reads back swapped on the other byte order
+    uint32_t byteOrder;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t stringsOffset;
+    uint64_t dataOffset;
+    uint64_t fileSize;
+  };
+
+  struct IndexEntry {
+    uint64_t pathOffset;
+    uint64_t titleOffset;
+    uint64_t dataOffset;
+    uint32_t nBins;
+    uint32_t reserved;
+  };
+
+  /// Read-only view into a mapped store, valid while the Reader is open
+  struct HistoView {
+    const char* path;
+    const char* title;
+    unsigned int nBins;
+    const StoredBin* bins;
+  };
+
+  /// Parse every dataPointSet of an AIDA file, paths are "<path>/<name>"
+  bool ReadAIDA(const std::string& fileName, std::vector<Histogram>& histos);
+
+  /// Write histograms as an AIDA file in Rivet's layout, which ReadAIDA
+  /// and the Rivet tools read back
+  bool WriteAIDA(const std::string& fileName, const std::vector<Histogram>& histos);
+
+  /// Write histograms to an indexed store
+  bool Write(const std::string& fileName, const std::vector<Histogram>& histos);
+
+  class Reader {
+  public:
+    Reader();
+    ~Reader();
+    bool open(const std::string& fileName);
+    void close();
+    bool isOpen() const { return _base != 0; }
+    /// Number of histograms in the store
+    unsigned int size() const;
+    /// Path of the i'th histogram, in sorted order
+    const char* path(unsigned int i) const;
+    /// Look up a histogram by full path, false if it isn't there
+    bool find(const std::string& path, HistoView& view) const;
+  private:
+    Reader(const Reader&);
+    Reader& operator=(const Reader&);
+    void fillView(const IndexEntry& entry, HistoView& view) const;
+    bool validate() const;
+    const char* _base;
+    size_t _length;
+    const FileHeader* _header;
+    const IndexEntry* _index;
+  };
+}
+#endif
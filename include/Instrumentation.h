@@ -0,0 +1,84 @@
+//-*- C++ -*-
+
+#ifndef RIVET_Instrumentation_HH
+#define RIVET_Instrumentation_HH
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+namespace Rivet{
+  /// Timers and counters around the observable blocks of the analyses.
+  ///
+  /// Only built with -DJETSTUDY_INSTRUMENT (make INSTRUMENT=1); otherwise
+  /// the JETSTUDY_* macros below expand to nothing. A block records its
+  /// call count, a log scale histogram of its wall time (quarter octaves
+  /// of CLOCK_MONOTONIC nanoseconds, enough for percentiles) and, where
+  /// given, the number of constituents it worked on. Every thread records
+  /// into its own table, found through a pthread key as the scratch arenas
+  /// are; the tables are merged when the report is written.
+  ///
+  /// The report of an analysis goes to
+  /// JETSTUDY_INSTRUMENT_DIR/<analysis>.instrument.json (and .csv, one row
+  /// per block), default the working directory, with the cut flow, the
+  /// counters and per block calls, total time, mean, 50/90/99% quantiles,
+  /// maximum and the constituent count histogram.
+  namespace Instrumentation {
+    /// (stage, events passing) in cut order
+    typedef std::vector<std::pair<std::string, long> > CutFlow;
+
+    /// Monotonic clock in nanoseconds
+    uint64_t Now();
+
+    /// Id of a block or counter, registered once per call site
+    unsigned int Register(const char* group, const char* name);
+
+    /// One call of a block taking ns nanoseconds over constituents
+    /// particles, constituents < 0 if that does not apply
+    void Record(unsigned int id, uint64_t ns, long constituents);
+
+    /// Add n to a counter
+    void Count(unsigned int id, long n);
+
+    /// Write the report of every block of this group; call once the event
+    /// loop is done
+    void Report(const std::string& group, const CutFlow& cutFlow);
+
+    /// Times the enclosing scope
+    class ScopedTimer {
+    public:
+      explicit ScopedTimer(unsigned int id, long constituents = -1)
+        : _id(id), _constituents(constituents), _start(Now()) {}
+      ~ScopedTimer() { Record(_id, Now() - _start, _constituents); }
+    private:
+      unsigned int _id;
+      long _constituents;
+      uint64_t _start;
+    };
+  }
+}
+
+#define JETSTUDY_CONCAT_(a, b) a##b
+#define JETSTUDY_CONCAT(a, b) JETSTUDY_CONCAT_(a, b)
+#ifdef JETSTUDY_INSTRUMENT
+/// Time the rest of the enclosing scope as block `name` of `group`
+#define JETSTUDY_TIME(group, name) JETSTUDY_TIME_N(group, name, -1)
+/// The same, recording the number of constituents worked on
+#define JETSTUDY_TIME_N(group, name, constituents) \
+  static const unsigned int JETSTUDY_CONCAT(jetstudyProbe, __LINE__) = \
+    Rivet::Instrumentation::Register(group, name); \
+  const Rivet::Instrumentation::ScopedTimer JETSTUDY_CONCAT(jetstudyTimer, __LINE__)( \
+    JETSTUDY_CONCAT(jetstudyProbe, __LINE__), constituents)
+/// Add n to counter `name` of `group`
+#define JETSTUDY_COUNT(group, name, n) do { \
+    static const unsigned int jetstudyCounter = Rivet::Instrumentation::Register(group, name); \
+    Rivet::Instrumentation::Count(jetstudyCounter, n); \
+  } while (0)
+/// Write the report of `group`
+#define JETSTUDY_REPORT(group, cutFlow) Rivet::Instrumentation::Report(group, cutFlow)
+#else
+#define JETSTUDY_TIME(group, name)
+#define JETSTUDY_TIME_N(group, name, constituents)
+#define JETSTUDY_COUNT(group, name, n) do {} while (0)
+#define JETSTUDY_REPORT(group, cutFlow)
+#endif
+#endif
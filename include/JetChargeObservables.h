@@ -0,0 +1,127 @@
+//-*- C++ -*-
+
+#ifndef RIVET_JetChargeObservables_HH
+#define RIVET_JetChargeObservables_HH
+#include <map>
+#include <ostream>
+#include <string>
+#include "BOOSTFastJets.h"
+#include "MultiWeightHisto.h"
+#include "Instrumentation.h"
+#include "RunningMoments.h"
+
+typedef std::map<std::string,Rivet::MultiWeightHisto1D> BookedHistos;
+namespace Rivet {
+
+  /// Selection and observables of MC_GENSTUDY_JETCHARGE, without the
+  /// projections.
+  ///
+  /// The analysis and the stand-alone runner (jetstudyrun) both feed this
+  /// class, the analysis from its projections and the runner from jcev
+  /// files, so the two fill the same histograms from the same code.
+  class JetChargeObservables {
+  public:
+    JetChargeObservables();
+
+    /// Book the histograms and read the JETSTUDY_* options. Radii of the
+    /// R scan are configured first, the caller needs them for its C/A jets.
+    void book(HistogramBackend& backend);
+
+    /// Necessary condition for the W finder muon cuts: a muon in
+    /// |eta| < 2.4 with pT > 25 GeV, where photons within the dressing
+    /// cone of 0.6 may bring it into acceptance. Much cheaper than the
+    /// W finder, which most events fail.
+    static bool hasMuonCandidate(const ParticleVector& particles);
+
+    /// Leading C/A jet of each radius, same cuts as the anti-kt jet
+    void analyzeRadii(const FastJets& camJets, int wCharge, const EventWeights& weight);
+
+    /// Everything after the W: anti-kt R = 0.6 jets of the rest of the
+    /// event, the W charge and the partons for truth matching (quarks and
+    /// gluons of any status). False if there is no jet, the event is vetoed.
+    bool analyzeJets(const FastJets& jetProjection, int wCharge, const ParticleVector& partons,
+		     const EventWeights& weight);
+
+    /// Cut summary; stageTime holds the seconds spent deciding each of the
+    /// last four cuts
+    void printCutFlow(std::ostream& os, const double* stageTime) const;
+    /// The cut flow for the instrumentation report
+    Instrumentation::CutFlow cutFlow() const;
+    /// Thinning and precision reports, mean jet charge and the moments
+    void print(std::ostream& os, const std::string& name);
+
+    /// Every histogram, for checkpointing and the convergence monitor
+    void booked(std::map<std::string, MultiWeightHisto1D*>& histos);
+    /// Exact moments of jet charge, pull, n-subjettiness and groomed
+    /// masses, nominal weight
+    MomentSet& moments() { return _moments; }
+    MultiRadiusJets& radii() { return _radii; }
+    /// Event count for efficiency studies: inclusive, muon candidate, W
+    /// found, jets, fiducial. The first three are counted by the caller.
+    int* nPassing() { return _nPassing; }
+
+  private:
+    /// Parton ids |pdgId| <= kMaxPdgId have a slot of their own in the
+    /// dispatch table, anything else shares the last one
+    enum { kMaxPdgId = 21, kPartonSlots = 2*kMaxPdgId + 2 };
+
+    void bookChargeHistograms(HistogramBackend& backend);
+    /// Entry of the dispatch table for the k of index kIndex, W charge
+    /// +-1 and the truth parton
+    size_t chargeIndex(unsigned int kIndex, int wCharge, int pdgId) const {
+      unsigned int slot = pdgId + kMaxPdgId;
+      if(slot >= kPartonSlots) slot = kPartonSlots - 1;
+      return (2*kIndex + (wCharge + 1)/2)*kPartonSlots + slot;
+    }
+    void fillChargeHistograms(const fastjet::PseudoJet& jet, const FastJets& jetProjection,
+			      const unsigned int kIndex, const int wCharge,
+			      const EventWeights& weight, const int pdgId);
+    /// Tau_2 of the jet with the given axes, checked against the double
+    /// kernel when validating
+    void fillNSubJettiness(const std::string& name, const PseudoJets& constituents,
+			   const PseudoJets& axes, const EventWeights& weight);
+    /// Leading jet observables at every threshold of _ptScan
+    void analyzePtScan(const FastJets& jetProjection, const fastjet::PseudoJet& jet,
+		       const int wCharge, const EventWeights& weight);
+    void analyzeSubJets(const fastjet::PseudoJet& jet, const EventWeights& weight);
+
+    ///@param _histograms Indexed by histogram name for easy management
+    ///until Rivet Autobooking takes over, allows any number of
+    ///histograms to be added "on the fly" in book().
+    ///Each entry holds one histogram per weight stream.
+    BookedHistos _histograms;
+    int _nPassing[5];
+    /// @param _ecfBeta Angular exponent and truncation of the energy correlations
+    double _ecfBeta;
+    unsigned int _ecfMaxN;
+    /// @param _thinning Optional thinning of large jets before the
+    /// energy correlations, JETSTUDY_JETCHARGE_THIN_*
+    ConstituentThinning _thinning;
+    /// @param _precision Float kernels against double, JETSTUDY_PRECISION_VALIDATE
+    PrecisionCheck _precision;
+    /// @param _moments Filled next to the histograms of the same name
+    MomentSet _moments;
+    /// @param _kappas Jet charge exponents, JETSTUDY_JETCHARGE_KAPPAS
+    std::vector<double> _kappas;
+    /// @param _chargeNames Inclusive jet charge histogram of each k, and
+    /// its moments
+    std::vector<std::string> _chargeNames;
+    std::vector<RunningMoments*> _chargeMoments;
+    /// @param _chargeDispatch Histograms to fill per (k, W charge, parton),
+    /// see chargeIndex(); built with the histograms in book()
+    std::vector<std::vector<MultiWeightHisto1D*> > _chargeDispatch;
+    /// @param _ptScan Constituent pT thresholds of the pull, charge and
+    /// dipolarity scan, JETSTUDY_JETCHARGE_PTMIN_SCAN, with its histograms
+    /// by threshold (the charge by k, then threshold)
+    ThresholdScan _ptScan;
+    std::vector<MultiWeightHisto1D*> _scanPullMag, _scanPullTheta, _scanDipolarity, _scanCharge;
+    /// @param _validatePtScan JETSTUDY_PTMIN_SCAN_VALIDATE=1 also calls
+    /// JetPull() and JetCharge() per threshold and keeps the largest deviation
+    bool _validatePtScan;
+    double _ptScanMaxDev;
+    /// @param _radii Radii of the C/A scan, JETSTUDY_JETCHARGE_RADII
+    MultiRadiusJets _radii;
+    PseudoJets _radiusJets;
+  };
+}
+#endif
@@ -0,0 +1,103 @@
+//-*- C++ -*-
+
+#ifndef RIVET_KernelMath_HH
+#define RIVET_KernelMath_HH
+#include <cmath>
+#include <stdint.h>
+namespace Rivet{
+  /// Precision of the observable kernels (ASF mesh, N-subjettiness
+  /// distances, jet charge sums). Double by default; make PRECISION=float
+  /// builds them in single precision with the approximations below, which
+  /// PrecisionCheck validates against the double kernels.
+#ifdef JETSTUDY_FLOAT_KERNELS
+  typedef float KernelReal;
+#else
+  typedef double KernelReal;
+#endif
+
+  /// Maths of the kernels at precision Real. The double versions are the
+  /// libm calls the kernels have always made, so the default build gives
+  /// the same results bit for bit.
+  template <typename Real> struct KernelMath;
+
+  template <> struct KernelMath<double> {
+    static double exp(double x) { return std::exp(x); }
+    static double erf(double x) { return ::erf(x); }
+    static double pow(double x, double y) { return std::pow(x, y); }
+    /// exp(-x^2), as the ASF has always written it
+    static double gauss(double x) { return std::exp(-std::pow(std::fabs(x), 2.0)); }
+  };
+
+  /// Branch free single precision approximations, which vectorise (with
+  /// -fno-trapping-math, as make PRECISION=float builds)
+  template <> struct KernelMath<float> {
+    /// Relative error below 1e-7; x is clamped to [-87, 88], so the result
+    /// never underflows to zero or overflows
+    static float exp(float x) {
+      x = x < -87.f ? -87.f : (x > 88.f ? 88.f : x);
+      //x = n ln2 + r, |r| <= ln2/2, ln2 split in two for the reduction
+      const int32_t n = static_cast<int32_t>(x*1.44269504f + (x < 0.f ? -0.5f : 0.5f));
+      const float fn = static_cast<float>(n);
+      const float r = (x - fn*0.693359375f) + fn*2.12194440e-4f;
+      float p = 1.9875691500e-4f;
+      p = p*r + 1.3981999507e-3f;
+      p = p*r + 8.3334519073e-3f;
+      p = p*r + 4.1665795894e-2f;
+      p = p*r + 1.6666665459e-1f;
+      p = p*r + 5.0000001201e-1f;
+      p = p*r*r + r + 1.f;
+      //2^n from the exponent bits
+      union { int32_t i; float f; } scale;
+      scale.i = (n + 127) << 23;
+      return p*scale.f;
+    }
+
+    /// Abramowitz and Stegun 7.1.26, absolute error below 5e-7 in float
+    static float erf(float x) {
+      const float a = std::fabs(x);
+      const float t = 1.f/(1.f + 0.3275911f*a);
+      float p = 1.061405429f;
+      p = p*t - 1.453152027f;
+      p = p*t + 1.421413741f;
+      p = p*t - 0.284496736f;
+      p = p*t + 0.254829592f;
+      const float y = 1.f - p*t*exp(-a*a);
+      return x < 0.f ? -y : y;
+    }
+
+    /// Natural logarithm of x > 0, relative error below 1e-7
+    static float log(float x) {
+      union { float f; int32_t i; } bits;
+      bits.f = x;
+      //x = m 2^e with m in [sqrt(1/2), sqrt(2))
+      int32_t e = ((bits.i >> 23) & 0xff) - 127;
+      bits.i = (bits.i & 0x007fffff) | 0x3f800000;
+      float m = bits.f;
+      const bool high = m > 1.41421356f;
+      m = high ? 0.5f*m : m;
+      e += high ? 1 : 0;
+      const float f = m - 1.f;
+      const float z = f*f;
+      float p = 7.0376836292e-2f;
+      p = p*f - 1.1514610310e-1f;
+      p = p*f + 1.1676998740e-1f;
+      p = p*f - 1.2420140846e-1f;
+      p = p*f + 1.4249322787e-1f;
+      p = p*f - 1.6668057665e-1f;
+      p = p*f + 2.0000714765e-1f;
+      p = p*f - 2.4999993993e-1f;
+      p = p*f + 3.3333331174e-1f;
+      const float fe = static_cast<float>(e);
+      return f + (p*f*z - 0.5f*z) + fe*0.693147180f;
+    }
+
+    /// x^y for x >= 0; 0^y is 0 for y > 0 as for std::pow
+    static float pow(float x, float y) {
+      const float r = exp(y*log(x > 0.f ? x : 1.f));
+      return x > 0.f ? r : (y > 0.f ? 0.f : 1.f);
+    }
+
+    static float gauss(float x) { return exp(-x*x); }
+  };
+}
+#endif
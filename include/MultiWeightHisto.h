@@ -0,0 +1,97 @@
+//-*- C++ -*-
+
+#ifndef RIVET_MultiWeightHisto_HH
+#define RIVET_MultiWeightHisto_HH
+#include <map>
+#include <string>
+#include <vector>
+#include "Rivet/RivetAIDA.hh"
+namespace Rivet{
+  class Event;
+  class AnalysisCheckpoint;
+  class ConvergenceMonitor;
+
+  /// One weight per weight stream, [0] is always the nominal event weight
+  typedef std::vector<double> EventWeights;
+
+  /// Named event weights to histogram alongside the nominal one.
+  ///
+  /// JETSTUDY_WEIGHTS lists HepMC weight names or indices, e.g.
+  /// "MSTW2008,CTEQ6L1" or "1,2", so PDF and scale variations written by the
+  /// generator fill their own copy of every histogram in the same run.  The
+  /// copies are booked as <name>_<weight>.
+  class WeightStreams {
+  public:
+    WeightStreams();
+    void configure();
+    /// Number of streams, including the nominal one
+    size_t size() const { return _suffixes.size(); }
+    /// Histogram name suffix of stream i, empty for the nominal stream
+    const std::string& suffix(size_t i) const { return _suffixes[i]; }
+    /// Weights of this event for every stream
+    void weights(const Event& event, EventWeights& w) const;
+    /// The same from a plain weight array, e.g. a jcev event, with the
+    /// weight names of its file
+    void weights(const double* values, size_t n, const std::vector<std::string>& names,
+                 EventWeights& w) const;
+  private:
+    void missing(size_t i, EventWeights& w) const;
+    std::vector<std::string> _names;
+    std::vector<int> _indices;
+    std::vector<std::string> _suffixes;
+    mutable std::vector<bool> _warned;
+  };
+
+  /// The same histogram booked once per weight stream
+  class MultiWeightHisto1D {
+  public:
+    void add(AIDA::IHistogram1D* histo) { _histos.push_back(histo); }
+    size_t size() const { return _histos.size(); }
+    AIDA::IHistogram1D*& operator[](size_t i) { return _histos[i]; }
+    const AIDA::IHistogram1D* operator[](size_t i) const { return _histos[i]; }
+    /// Width of the (equal) bins
+    double binWidth() const { return _histos[0]->axis().binWidth(0); }
+
+    /// Fill every stream with its own weight
+    void fill(double x, const EventWeights& w) {
+      for (size_t i = 0; i < _histos.size(); i++) _histos[i]->fill(x, w[i]);
+    }
+    /// Unit weight in every stream
+    void fill(double x) {
+      for (size_t i = 0; i < _histos.size(); i++) _histos[i]->fill(x);
+    }
+  private:
+    std::vector<AIDA::IHistogram1D*> _histos;
+  };
+
+  /// Where the observable code books and normalises its histograms: the
+  /// Rivet analyses, or the stand-alone runner (jetstudyrun).
+  ///
+  /// The weight streams are handled here; a backend only books and scales
+  /// single histograms.
+  class HistogramBackend {
+  public:
+    /// streams must outlive the backend, it may still be unconfigured
+    explicit HistogramBackend(const WeightStreams& streams) : _streams(streams) {}
+    virtual ~HistogramBackend() {}
+    /// Book one copy of the histogram per weight stream, <name><suffix>
+    MultiWeightHisto1D bookMultiWeight(const std::string& name, size_t nbins, double lower, double upper);
+    /// Normalise every weight stream to unit area, overflows included, as
+    /// Analysis::normalize
+    void normalize(MultiWeightHisto1D& histo);
+    virtual void scale(AIDA::IHistogram1D*& histo, double factor) = 0;
+    /// Add every weight stream of the histograms to the checkpoint and the
+    /// nominal ones to the convergence monitor, then start the monitor.
+    /// The caller adds its counters and restores the checkpoint afterwards.
+    void registerHistograms(const std::map<std::string, MultiWeightHisto1D*>& histos,
+                            AnalysisCheckpoint& checkpoint, ConvergenceMonitor& convergence) const;
+  protected:
+    const WeightStreams& weightStreams() const { return _streams; }
+  private:
+    /// One histogram, named with its stream suffix
+    virtual AIDA::IHistogram1D* bookHistogram(const std::string& name, size_t nbins,
+                                              double lower, double upper) = 0;
+    const WeightStreams& _streams;
+  };
+}
+#endif
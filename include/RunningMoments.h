@@ -0,0 +1,76 @@
+//-*- C++ -*-
+
+#ifndef RIVET_RunningMoments_HH
+#define RIVET_RunningMoments_HH
+#include <map>
+#include <ostream>
+#include <string>
+namespace Rivet{
+  /// Exact weighted mean and variance of one quantity, updated per fill.
+  ///
+  /// The histogram mean and rms are taken from bin centres and lose
+  /// everything outside the axis range; these are the moments of the
+  /// values themselves. fill() is the weighted Welford update (West 1979),
+  /// O(1) and stable for large means; merge() combines two accumulators
+  /// as if every fill had gone into one (Chan, Golub and LeVeque).
+  class RunningMoments {
+  public:
+    RunningMoments() : _entries(0), _sumW(0.), _sumW2(0.), _mean(0.), _m2(0.) {}
+    /// From saved state, see MomentSet::read()
+    RunningMoments(long entries, double sumW, double sumW2, double mean, double m2)
+      : _entries(entries), _sumW(sumW), _sumW2(sumW2), _mean(mean), _m2(m2) {}
+
+    /// Negative weights are fine as long as the sum of weights does not
+    /// pass through zero
+    void fill(double x, double w = 1.);
+    void merge(const RunningMoments& other);
+
+    long entries() const { return _entries; }
+    double sumW() const { return _sumW; }
+    double sumW2() const { return _sumW2; }
+    double mean() const { return _mean; }
+    /// Sum of w (x - mean)^2
+    double m2() const { return _m2; }
+    /// m2()/sumW(), the definition of the histogram rms
+    double variance() const;
+    double rms() const;
+    /// Error of the mean, rms sqrt(sum w^2)/sum w
+    double meanError() const;
+
+  private:
+    long _entries;
+    double _sumW, _sumW2, _mean, _m2;
+  };
+
+  /// Moments of the key quantities of one analysis instance, by name.
+  ///
+  /// Every analysis thread fills its own set, nothing is shared. Sets are
+  /// ordered by name, so the output and merge(), which goes name by name,
+  /// are the same whatever order the quantities were first filled in.
+  /// Entries are stable, a RunningMoments& taken once may be kept.
+  class MomentSet {
+  public:
+    typedef std::map<std::string, RunningMoments> Map;
+
+    RunningMoments& operator[](const std::string& name) { return _moments[name]; }
+    void fill(const std::string& name, double x, double w) { _moments[name].fill(x, w); }
+    /// Add other into this set; quantities missing here are added
+    void merge(const MomentSet& other);
+    const Map& moments() const { return _moments; }
+    bool empty() const { return _moments.empty(); }
+
+    /// JSON with one object per quantity, at full precision
+    bool write(const std::string& fileName, const std::string& analysis) const;
+    /// Read back what write() wrote, replacing the contents
+    bool read(const std::string& fileName, std::string& analysis);
+    /// Write JETSTUDY_MOMENTS_DIR/<analysis>.moments.json, default the
+    /// working directory, at finalize
+    void report(const std::string& analysis) const;
+    /// One line per quantity: entries, mean +/- error, rms
+    void print(std::ostream& os) const;
+
+  private:
+    Map _moments;
+  };
+}
+#endif
@@ -0,0 +1,90 @@
+//-*- C++ -*-
+
+#ifndef RIVET_ScratchArena_HH
+#define RIVET_ScratchArena_HH
+#include <cstddef>
+#include <new>
+#include <vector>
+namespace Rivet{
+  /// Bump allocator for per-event scratch space.
+  ///
+  /// The observable helpers draw their temporary buffers (particle pairs,
+  /// ASF meshes, axis sums) from the arena of the calling thread, and the
+  /// analysis releases all of it at once with reset() when the next event
+  /// starts.  Memory is never handed back individually.  After a reset the
+  /// blocks are merged into one, so once the largest event has been seen
+  /// the event loop does not call malloc for scratch space at all.
+  class ScratchArena {
+  public:
+    explicit ScratchArena(size_t blockSize = 1 << 20);
+    ~ScratchArena();
+
+    /// Memory for bytes bytes, aligned for any scalar type
+    void* allocate(size_t bytes);
+
+    /// Release everything allocated since the last reset
+    void reset();
+
+    /// Bytes held, used or not
+    size_t capacity() const;
+
+    /// The arena of the calling thread
+    static ScratchArena& local();
+
+  private:
+    ScratchArena(const ScratchArena&);
+    ScratchArena& operator=(const ScratchArena&);
+
+    size_t _blockSize;
+    std::vector<char*> _blocks;
+    std::vector<size_t> _sizes;
+    size_t _current;
+    size_t _offset;
+  };
+
+  /// Standard allocator handing out arena memory, deallocate is a no-op
+  template <typename T>
+  class ArenaAllocator {
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template <typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    ArenaAllocator() : _arena(&ScratchArena::local()) {}
+    explicit ArenaAllocator(ScratchArena& arena) : _arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.arena()) {}
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    pointer allocate(size_type n, const void* = 0) {
+      return static_cast<pointer>(_arena->allocate(n*sizeof(T)));
+    }
+    void deallocate(pointer, size_type) {}
+    size_type max_size() const { return size_t(-1)/sizeof(T); }
+    void construct(pointer p, const T& val) { new(static_cast<void*>(p)) T(val); }
+    void destroy(pointer p) { p->~T(); }
+
+    ScratchArena* arena() const { return _arena; }
+  private:
+    ScratchArena* _arena;
+  };
+
+  template <typename T, typename U>
+  bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+  template <typename T, typename U>
+  bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+  /// std::vector living in the thread's scratch arena, valid until the
+  /// next ScratchArena::reset()
+  template <typename T>
+  struct ScratchVector {
+    typedef std::vector<T, ArenaAllocator<T> > type;
+  };
+}
+#endif
@@ -0,0 +1,72 @@
+//-*- C++ -*-
+
+#ifndef RIVET_StandaloneAnalysis_HH
+#define RIVET_StandaloneAnalysis_HH
+#include <string>
+#include <utility>
+#include <vector>
+#include "Rivet/Rivet.hh"
+#include "Rivet/Particle.hh"
+#include "MultiWeightHisto.h"
+#include "EventStore.h"
+#include "HistoStore.h"
+
+/// What jetstudyrun needs in place of the Rivet runtime: particles straight
+/// from jcev events, a W finder working on them and histograms which are
+/// written as Rivet writes its AIDA files.
+namespace Rivet {
+
+  /// Final state particles (status 1, in file order as the FinalState
+  /// projection sees them) and the quarks and gluons of any status
+  void ReadParticles(const EventStore::EventView& view, ParticleVector& finalState,
+		     ParticleVector& partons);
+
+  /// Particles of the final state with |eta| < maxEta, FinalState(-maxEta, maxEta)
+  void SelectEta(const ParticleVector& particles, double maxEta, ParticleVector& selected);
+
+  /// The muon W finder of MC_GENSTUDY_JETCHARGE, as the WFinder projection
+  /// configures it: muons dressed with the photons within 0.6, |eta| < 2.4
+  /// and pT > 25 GeV, paired with the matching muon neutrino; the pair with
+  /// the transverse mass closest to 80.4 GeV in 40 - 1000 GeV is the W if
+  /// the visible scalar ET is at least 25 GeV (Rivet 1.8 cuts on that
+  /// rather than the missing ET). remaining is the final state without the
+  /// bare muon and the neutrino, the dressing photons stay in.
+  bool FindMuonW(const ParticleVector& finalState, Particle& boson, ParticleVector& remaining);
+
+  /// Minimum bias events from a jcev file laid over the hard events, for
+  /// scaling tests at higher multiplicity. Final state and partons are both
+  /// added, so the truth matching loops over the partons scale as well.
+  class PileupOverlay {
+  public:
+    PileupOverlay();
+    bool open(const std::string& fileName);
+    bool isOpen() const { return _reader.isOpen(); }
+    /// Append the final state and partons of the next k events of the
+    /// file, which is read round robin
+    bool overlay(unsigned int k, ParticleVector& finalState, ParticleVector& partons);
+  private:
+    EventStore::Reader _reader;
+    EventStore::EventView _view;
+    ParticleVector _finalState, _partons;
+    uint64_t _next;
+  };
+
+  /// Histograms owned by the stand-alone runner, for one analysis
+  class StandaloneHistograms : public HistogramBackend {
+  public:
+    /// path is the AIDA path, "/<analysis name>"
+    StandaloneHistograms(const std::string& path, const WeightStreams& streams);
+    ~StandaloneHistograms();
+    void scale(AIDA::IHistogram1D*& histo, double factor);
+    /// As Rivet writes histograms: one point per bin at its centre, heights
+    /// and errors divided by the bin width
+    void collect(std::vector<HistoStore::Histogram>& histos) const;
+  private:
+    StandaloneHistograms(const StandaloneHistograms&);
+    StandaloneHistograms& operator=(const StandaloneHistograms&);
+    AIDA::IHistogram1D* bookHistogram(const std::string& name, size_t nbins, double lower, double upper);
+    std::string _path;
+    std::vector<std::pair<std::string, AIDA::IHistogram1D*> > _histos;
+  };
+}
+#endif
@@ -0,0 +1,136 @@
+//-*- C++ -*-
+
+#ifndef RIVET_SubstructureObservables_HH
+#define RIVET_SubstructureObservables_HH
+#include <map>
+#include <ostream>
+#include <string>
+#include "BOOSTFastJets.h"
+#include "MultiWeightHisto.h"
+#include "Instrumentation.h"
+#include "RunningMoments.h"
+
+namespace Rivet {
+
+  /// Selection and observables of MC_GENSTUDY_JET_SUBSTRUCTURE, without
+  /// the projections, shared by the analysis and jetstudyrun as
+  /// JetChargeObservables is.
+  class SubstructureObservables {
+
+    /// Need these for average angular structure function.
+    /// Please look at the paper (http://arxiv.org/abs/arXiv:1201.2688)
+    /// for in depth explanation, but the idea is to calculate the
+    /// ASF and normalisation for all jets separately,
+    /// then adding them up AFTER the run.
+    /// The sums are kept in their own histograms (averageasf_num and
+    /// averageasf_den) so outputs of split jobs can be added and the
+    /// ratio taken after merging; averageasf is only the ratio for this job.
+    unsigned int meshsize;
+    double Rmax;
+
+  public:
+    SubstructureObservables();
+
+    /// Book the histograms and read the JETSTUDY_* options. Radii of the
+    /// R scan are configured first, the caller needs them for its C/A jets.
+    void book(HistogramBackend& backend);
+
+    /// Histograms filled event by event, for checkpointing and the
+    /// convergence monitor. averageasf itself is only filled in finalize().
+    void booked(std::map<std::string, MultiWeightHisto1D*>& histos);
+
+    /// Skip the clustering if no R = 1.2 region (or larger, for the R
+    /// scan) of the event holds 350 GeV, most QCD events never come close.
+    /// A heuristic, see MaxConePt, so only with JETSTUDY_PREVETO=1. True
+    /// if the event is vetoed; with JETSTUDY_PREVETO_VALIDATE=1 it is
+    /// clustered anyway, to check the pre-veto on a sample.
+    bool preVeto(const ParticleVector& particles, const EventWeights& weight);
+
+    /// Observables of the selected anti-kt R = 1.2 jets, and of the R scan
+    /// when camJets, the C/A clustering at radii().maxRadius(), is given
+    void analyze(const FastJets& jetProjection, const FastJets* camJets, const EventWeights& weight);
+
+    /// Average ASF from the accumulated sums and normalisation
+    void finalize(HistogramBackend& backend);
+    /// Pre-veto, jet shape, thinning and precision reports and the moments
+    void print(std::ostream& os, const std::string& name);
+    /// The cut flow for the instrumentation report
+    Instrumentation::CutFlow cutFlow() const;
+    /// Exact moments of the tau ratios and groomed masses, nominal weight
+    MomentSet& moments() { return _moments; }
+
+    MultiRadiusJets& radii() { return _radii; }
+    /// Events rejected by the tower pre-veto and, when validating, those
+    /// the jet selection accepted after all
+    int* nPreVeto() { return _nPreVeto; }
+
+    /// Eccentricity, planar flow, width and angularity of a jet
+    struct JetShapes {
+        double ecc;
+        double pflow;
+        double width;
+        double angularity;
+    };
+
+  private:
+    /// Mass, pT, tau_32 and D2 of the selected C/A jets at every radius
+    void analyzeRadii(const FastJets& camJets, const EventWeights& weight);
+    void compareShapes(const SelectedJet& jet, const JetShapes& shapes);
+
+    /// One histogram per weight stream, [0] holds the nominal weights
+    MultiWeightHisto1D _h_njets, _h_jetmass, _h_jetpt, _h_jetd12, _h_jetd23;
+    MultiWeightHisto1D _h_ecc, _h_width, _h_pflow, _h_angularity;
+
+    MultiWeightHisto1D _h_FiltMass, _h_TrimMass, _h_PrunMass;
+
+    MultiWeightHisto1D _h_3subjet, _h_2subjet, _h_1subjet, _h_21subjet, _h_32subjet;
+
+    MultiWeightHisto1D _h_ASF_1peak_m, _h_ASF_1peak_r, _h_ASF_2peak_m1,
+         _h_ASF_2peak_r1, _h_ASF_2peak_m2, _h_ASF_2peak_r2, _h_ASF_3peak_m1,
+         _h_ASF_3peak_r1, _h_ASF_3peak_m2, _h_ASF_3peak_r2, _h_ASF_3peak_m3,
+         _h_ASF_3peak_r3, _h_npeaks, _h_averageasf;
+
+    MultiWeightHisto1D _h_ECF_C2, _h_ECF_D2, _h_ECF_C3;
+    double _ecfBeta;
+    unsigned int _ecfMaxN;
+
+    /// Optional thinning of large jets before the ECFs and the ASF,
+    /// JETSTUDY_SUBSTRUCTURE_THIN_*
+    ConstituentThinning _thinning;
+
+    /// Float kernels against double, JETSTUDY_PRECISION_VALIDATE
+    PrecisionCheck _precision;
+
+    /// Moments of the key quantities, with the entries looked up once in
+    /// book()
+    MomentSet _moments;
+    RunningMoments *_m_21subjet, *_m_32subjet, *_m_FiltMass, *_m_TrimMass, *_m_PrunMass;
+
+    /// Optional R scan, JETSTUDY_SUBSTRUCTURE_RADII, one entry per radius
+    MultiRadiusJets _radii;
+    PseudoJets _radiusJets;
+    SelectedJets _radiusSelected;
+    std::vector<MultiWeightHisto1D> _h_R_jetmass, _h_R_jetpt, _h_R_32subjet, _h_R_ECF_D2;
+
+    /// Mergeable sums behind the average ASF
+    MultiWeightHisto1D _h_averageasf_num, _h_averageasf_den;
+
+    /// Pre-veto counts, see nPreVeto(); validation clusters every event.
+    int _nPreVeto[2];
+    bool _preVetoEnabled, _validatePreVeto;
+    /// Events seen and events with a selected jet, for cutFlow(); not
+    /// checkpointed
+    long _nEvents, _nSelected;
+    /// Whether the current event failed the pre-veto
+    bool _preVetoed;
+
+    /// JETSTUDY_SHAPES_VALIDATE=1 also runs the per-shape functions and
+    /// reports the largest deviation of the fused kernel.
+    bool _validateShapes;
+    double _shapesMaxDev;
+
+    /// Jets selected in this event
+    SelectedJets _jets;
+  };
+}
+#endif
@@ -1,6 +1,10 @@
 #!/usr/bin/python
 
 import sys
+import os
+import mmap
+import struct
+from array import array
 from ROOT import * #TCanvas, TROOT, THStack, TLegend, TSystem
 from ROOT import *
 ROOT.gROOT.LoadMacro("AtlasStyle.C") 
@@ -52,11 +56,72 @@ pythia_generators = [
     ['Pythia8.MSTW2008','Pythia 8, 4C, MSTW 2008',kMagenta+2],
     ['Pythia8.CTEQ6L1','Pythia 8, 4C, CTEQ6L1',kMagenta]
 ]
+class HistoStore(object):
+    """Indexed histogram store written by aida2hbin, see
+    include/HistoStore.h. The file is mapped and Get() only reads the bins
+    of the histogram asked for; like TFile.Get it hands back the same
+    object when asked again."""
+    header = struct.Struct('=8sIIIIQQQQ')
+    entry = struct.Struct('=QQQII')
+    storedBin = struct.Struct('=6d')
+    def __init__(self, fileName):
+        f = open(fileName, 'rb')
+        self.data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        f.close()
+        (magic, version, nHistos, byteOrder, reserved, indexOffset,
+         stringsOffset, dataOffset, fileSize) = self.header.unpack_from(self.data, 0)
+        if (magic != b'HBIN0001' or byteOrder != 0x01020304 or version != 2
+                or fileSize != len(self.data)):
+            raise IOError(fileName + ' is not a valid histogram store')
+        self.name = os.path.basename(fileName)
+        # by histogram name, the analyses do not share any
+        self.index = {}
+        for i in range(nHistos):
+            pathOffset, titleOffset, binsOffset, nBins, reserved = \
+                self.entry.unpack_from(self.data, indexOffset + i*self.entry.size)
+            path = self.string(pathOffset)
+            self.index[path.split('/')[-1]] = (path, self.string(titleOffset), binsOffset, nBins)
+        self.histos = {}
+    def string(self, offset):
+        return self.data[offset:self.data.find(b'\0', offset)].decode()
+    def Get(self, histName):
+        if histName in self.histos:
+            return self.histos[histName]
+        path, title, offset, nBins = self.index[histName]
+        bins = [self.storedBin.unpack_from(self.data, offset + i*self.storedBin.size)
+                for i in range(nBins)]
+        # x, x error -, x error +, y, y error -, y error +
+        edges = array('d', [b[0] - b[1] for b in bins] + [bins[-1][0] + bins[-1][2]])
+        h = TH1F(self.name + path, title, nBins, edges)
+        h.SetDirectory(0)
+        for i, b in enumerate(bins):
+            h.SetBinContent(i+1, b[3])
+            # Over estimate the error by taking the larger of the two
+            h.SetBinError(i+1, max(b[4], b[5]))
+        self.histos[histName] = h
+        return h
+def open_output(genName):
+    """The histogram store of a generator if there is one, else its
+    converted ROOT file"""
+    if os.path.exists('hbin/'+genName+'.hbin'):
+        return HistoStore('hbin/'+genName+'.hbin')
+    return TFile('rootfiles/'+genName+'.root')
 def set_hist_opts(hist, color):
     hist.SetLineColor(color)
     hist.SetMarkerColor(color) 
     hist.SetLineWidth(3)
     hist.SetMarkerStyle(1)
+def has_histo(output, histName):
+    """Whether a histogram store or ROOT file holds the histogram"""
+    if isinstance(output, HistoStore):
+        return histName in output.index
+    return bool(output.Get(histName))
+def average_asf(rootfile, name='averageasf_merged'):
+    """Average ASF of a (possibly merged) MC_GENSTUDY_JET_SUBSTRUCTURE
+    output, the ratio of the summed numerator and normalisation"""
+    num = rootfile.Get('averageasf_num').Clone(name)
+    num.Divide(rootfile.Get('averageasf_den'))
+    return num
 def print_histo(canvas,hist,prefix):
     canvas.RedrawAxis()
     canvas.SetLogy(hist[2])
@@ -86,6 +151,28 @@ def print_canon_hists(outPrefix, generators):
             leg = TLegend(0.72,0.65,.95,0.95)
         process_gens(generators,histo[0],leg,hs,histo[3])
         print_histo(c,histo,outPrefix)
+def print_average_asf(outPrefix, generators):
+    """Average ASF of every generator whose output has the substructure
+    analysis, taken from the merged sums rather than per job averages"""
+    hs = THStack('averageasf','Average ASF;#Delta R;#LT#Delta G#GT')
+    c = TCanvas('averageasf','Average ASF',800,600)
+    leg = TLegend(0.72,0.65,.95,0.95)
+    leg.SetFillColor(0)
+    leg.SetBorderSize(0)
+    hists = []
+    for gen in generators:
+        if not has_histo(gen[-1],'averageasf_num'):
+            continue
+        h = average_asf(gen[-1],'averageasf_'+gen[0])
+        set_hist_opts(h,gen[2])
+        hs.Add(h)
+        leg.AddEntry(h,gen[1])
+        hists.append(h)
+    if not hists:
+        return
+    hs.Draw('Hnostack')
+    leg.Draw()
+    print_histo(c,['averageasf','',False],outPrefix)
 def rebin_ratio_hists(generators,histList):
     for histo in histList:
         for gen in generators:
@@ -112,11 +199,11 @@ def print_ratio_hists(outPrefix,generators,histo,denHistName,sumDen):
     leg.Draw()
     print_histo(c,histo,outPrefix)
 
-# Open the .root files
+# Open the histogram stores, or the .root files where there are none
 for gen in boost_generators:
-    gen.append(TFile('rootfiles/'+gen[0]+'.root'));
+    gen.append(open_output(gen[0]))
 for gen in pythia_generators:
-    gen.append(TFile('rootfiles/'+gen[0]+'.root'));
+    gen.append(open_output(gen[0]))
 # Stack Quark and Gluon charge to show relative fractions
 klist=['K3','K5']
 for k in klist:
@@ -156,3 +243,5 @@ print_ratio_hists('BOOST_',boost_generators,ratioHistos[0],'GluonJetPt',True)
 # Print the 'canonical' histograms
 print_canon_hists('BOOST_',boost_generators)
 print_canon_hists('PDFComparison_',pythia_generators)
+print_average_asf('BOOST_',boost_generators)
+print_average_asf('PDFComparison_',pythia_generators)
@@ -0,0 +1,327 @@
+#include "AnalysisCheckpoint.h"
+#include "AnalysisOptions.h"
+#include "LWH/Histogram1D.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace Rivet {
+
+static const char* kCheckpointTag = "JETSTUDY-CHECKPOINT";
+static const int kCheckpointVersion = 3;
+
+AnalysisCheckpoint::AnalysisCheckpoint()
+    : _enabled(false), _everyEvents(1000), _everySeconds(600.),
+      _seen(0), _skip(0), _lastEvents(0), _lastTime(0),
+      _writerRunning(false), _hasPending(false), _stop(false) {
+    pthread_mutex_init(&_mutex, 0);
+    pthread_cond_init(&_cond, 0);
+}
+
+AnalysisCheckpoint::~AnalysisCheckpoint() {
+    finish();
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool AnalysisCheckpoint::configure(const std::string& analysisName) {
+    const std::string prefix = OptionString("CHECKPOINT");
+    if (prefix.empty()) return false;
+    _analysis = analysisName;
+    _fileName = prefix + "." + analysisName + ".ckpt";
+    _everyEvents = OptionInt("CHECKPOINT_EVENTS", 1000);
+    _everySeconds = OptionDouble("CHECKPOINT_SECONDS", 600.);
+    _lastTime = time(0);
+    _stop = false;
+    if (pthread_create(&_writer, 0, &AnalysisCheckpoint::writerLoop, this) != 0) {
+        std::cerr << "Could not start checkpoint writer, checkpointing disabled" << std::endl;
+        return false;
+    }
+    _writerRunning = true;
+    _enabled = true;
+    return true;
+}
+
+void AnalysisCheckpoint::addHistogram(const std::string& name, AIDA::IHistogram1D* histo) {
+    LWH::Histogram1D* lwh = dynamic_cast<LWH::Histogram1D*>(histo);
+    if (!lwh) {
+        std::cerr << name << " is not an LWH histogram, not checkpointed" << std::endl;
+        return;
+    }
+    _histos.push_back(std::make_pair(name, lwh));
+}
+
+void AnalysisCheckpoint::addCounter(const std::string& name, int* counters, unsigned int n) {
+    _counters.push_back(std::make_pair(name, std::make_pair(counters, n)));
+}
+
+void AnalysisCheckpoint::addMoments(const std::string& name, MomentSet* moments) {
+    _moments.push_back(std::make_pair(name, moments));
+}
+
+/// LWH keeps the per-bin sums private and has no setter for them. Access
+/// checking does not apply to the arguments of an explicit instantiation,
+/// so BinSums below hands out pointers to them, to save and restore the
+/// bins exactly.
+template <typename Tag, typename Tag::Type member>
+struct BinSums {
+    friend typename Tag::Type memberOf(Tag) { return member; }
+};
+struct Entries { typedef std::vector<int> LWH::Histogram1D::*Type; friend Type memberOf(Entries); };
+struct SumW { typedef std::vector<double> LWH::Histogram1D::*Type; friend Type memberOf(SumW); };
+struct SumW2 { typedef std::vector<double> LWH::Histogram1D::*Type; friend Type memberOf(SumW2); };
+struct SumXW { typedef std::vector<double> LWH::Histogram1D::*Type; friend Type memberOf(SumXW); };
+struct SumX2W { typedef std::vector<double> LWH::Histogram1D::*Type; friend Type memberOf(SumX2W); };
+template struct BinSums<Entries, &LWH::Histogram1D::sum>;
+template struct BinSums<SumW, &LWH::Histogram1D::sumw>;
+template struct BinSums<SumW2, &LWH::Histogram1D::sumw2>;
+template struct BinSums<SumXW, &LWH::Histogram1D::sumxw>;
+template struct BinSums<SumX2W, &LWH::Histogram1D::sumx2w>;
+
+bool AnalysisCheckpoint::restore() {
+    if (!_enabled) return false;
+    Snapshot snap;
+    if (!read(snap)) return false;
+    if (snap.analysis != _analysis) {
+        std::cerr << _fileName << " belongs to " << snap.analysis << ", not restoring" << std::endl;
+        return false;
+    }
+    for (unsigned int i = 0; i < snap.counters.size(); i++) {
+        for (unsigned int j = 0; j < _counters.size(); j++) {
+            if (_counters[j].first != snap.counters[i].name) continue;
+            for (unsigned int k = 0; k < _counters[j].second.second && k < snap.counters[i].values.size(); k++)
+                _counters[j].second.first[k] = snap.counters[i].values[k];
+        }
+    }
+    for (unsigned int i = 0; i < snap.moments.size(); i++) {
+        const MomentState& m = snap.moments[i];
+        for (unsigned int j = 0; j < _moments.size(); j++) {
+            if (_moments[j].first != m.set) continue;
+            (*_moments[j].second)[m.name] = RunningMoments(m.entries, m.sumw, m.sumw2, m.mean, m.m2);
+        }
+    }
+    for (unsigned int i = 0; i < snap.histos.size(); i++) {
+        for (unsigned int j = 0; j < _histos.size(); j++) {
+            if (_histos[j].first != snap.histos[i].name) continue;
+            LWH::Histogram1D& histo = *_histos[j].second;
+            const std::vector<BinState>& bins = snap.histos[i].bins;
+            if (bins.size() != (histo.*memberOf(Entries())).size()) {
+                std::cerr << "Binning of " << snap.histos[i].name << " changed, not restored" << std::endl;
+                continue;
+            }
+            for (unsigned int b = 0; b < bins.size(); b++) {
+                (histo.*memberOf(Entries()))[b] = bins[b].entries;
+                (histo.*memberOf(SumW()))[b] = bins[b].sumw;
+                (histo.*memberOf(SumW2()))[b] = bins[b].sumw2;
+                (histo.*memberOf(SumXW()))[b] = bins[b].sumxw;
+                (histo.*memberOf(SumX2W()))[b] = bins[b].sumx2w;
+            }
+        }
+    }
+    _skip = snap.events;
+    _lastEvents = snap.events;
+    std::cout << _analysis << ": resuming from " << _fileName << ", skipping "
+              << _skip << " analysed events" << std::endl;
+    return true;
+}
+
+bool AnalysisCheckpoint::nextEvent() {
+    if (!_enabled) return true;
+    _seen++;
+    if (_seen <= _skip) return false;
+    //state now reflects _seen-1 events
+    if (_seen - 1 - _lastEvents >= _everyEvents ||
+        difftime(time(0), _lastTime) >= _everySeconds) {
+        queueSnapshot();
+    }
+    return true;
+}
+
+void AnalysisCheckpoint::takeSnapshot(Snapshot& snap, unsigned long events) const {
+    snap.analysis = _analysis;
+    snap.events = events;
+    snap.counters.resize(_counters.size());
+    for (unsigned int i = 0; i < _counters.size(); i++) {
+        snap.counters[i].name = _counters[i].first;
+        snap.counters[i].values.assign(_counters[i].second.first,
+                                       _counters[i].second.first + _counters[i].second.second);
+    }
+    snap.moments.clear();
+    for (unsigned int i = 0; i < _moments.size(); i++) {
+        const MomentSet::Map& moments = _moments[i].second->moments();
+        for (MomentSet::Map::const_iterator it = moments.begin(); it != moments.end(); ++it) {
+            const MomentState state = {_moments[i].first, it->first, it->second.entries(), it->second.sumW(),
+                                       it->second.sumW2(), it->second.mean(), it->second.m2()};
+            snap.moments.push_back(state);
+        }
+    }
+    snap.histos.resize(_histos.size());
+    for (unsigned int i = 0; i < _histos.size(); i++) {
+        const LWH::Histogram1D& histo = *_histos[i].second;
+        HistoState& state = snap.histos[i];
+        state.name = _histos[i].first;
+        state.bins.resize((histo.*memberOf(Entries())).size());
+        for (unsigned int b = 0; b < state.bins.size(); b++) {
+            state.bins[b].entries = (histo.*memberOf(Entries()))[b];
+            state.bins[b].sumw = (histo.*memberOf(SumW()))[b];
+            state.bins[b].sumw2 = (histo.*memberOf(SumW2()))[b];
+            state.bins[b].sumxw = (histo.*memberOf(SumXW()))[b];
+            state.bins[b].sumx2w = (histo.*memberOf(SumX2W()))[b];
+        }
+    }
+}
+
+void AnalysisCheckpoint::queueSnapshot() {
+    Snapshot snap;
+    takeSnapshot(snap, _seen - 1);
+    pthread_mutex_lock(&_mutex);
+    //a slow disk only ever delays the newest state, older ones are dropped
+    _pending.histos.swap(snap.histos);
+    _pending.counters.swap(snap.counters);
+    _pending.moments.swap(snap.moments);
+    _pending.analysis = snap.analysis;
+    _pending.events = snap.events;
+    _hasPending = true;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+    _lastEvents = snap.events;
+    _lastTime = time(0);
+}
+
+void* AnalysisCheckpoint::writerLoop(void* self) {
+    AnalysisCheckpoint* cp = static_cast<AnalysisCheckpoint*>(self);
+    Snapshot snap;
+    pthread_mutex_lock(&cp->_mutex);
+    while (true) {
+        while (!cp->_hasPending && !cp->_stop)
+            pthread_cond_wait(&cp->_cond, &cp->_mutex);
+        if (!cp->_hasPending && cp->_stop) break;
+        snap.histos.swap(cp->_pending.histos);
+        snap.counters.swap(cp->_pending.counters);
+        snap.moments.swap(cp->_pending.moments);
+        snap.analysis = cp->_pending.analysis;
+        snap.events = cp->_pending.events;
+        cp->_hasPending = false;
+        pthread_mutex_unlock(&cp->_mutex);
+        cp->write(snap);
+        pthread_mutex_lock(&cp->_mutex);
+    }
+    pthread_mutex_unlock(&cp->_mutex);
+    return 0;
+}
+
+void AnalysisCheckpoint::finish() {
+    if (!_enabled) return;
+    if (_writerRunning) {
+        pthread_mutex_lock(&_mutex);
+        _stop = true;
+        pthread_cond_signal(&_cond);
+        pthread_mutex_unlock(&_mutex);
+        pthread_join(_writer, 0);
+        _writerRunning = false;
+    }
+    //final state, written synchronously
+    Snapshot snap;
+    takeSnapshot(snap, (_seen > _skip) ? _seen : _skip);
+    write(snap);
+    _enabled = false;
+}
+
+bool AnalysisCheckpoint::write(const Snapshot& snap) const {
+    //write next to the old checkpoint and rename, so a kill mid-write
+    //leaves the previous one intact
+    const std::string tmpName = _fileName + ".tmp";
+    std::ofstream out(tmpName.c_str());
+    if (!out) {
+        std::cerr << "Could not write checkpoint " << tmpName << std::endl;
+        return false;
+    }
+    out.precision(17);
+    out << kCheckpointTag << " " << kCheckpointVersion << "\n";
+    out << "analysis " << snap.analysis << "\n";
+    out << "events " << snap.events << "\n";
+    for (unsigned int i = 0; i < snap.counters.size(); i++) {
+        out << "counter " << snap.counters[i].name << " " << snap.counters[i].values.size();
+        for (unsigned int j = 0; j < snap.counters[i].values.size(); j++)
+            out << " " << snap.counters[i].values[j];
+        out << "\n";
+    }
+    for (unsigned int i = 0; i < snap.moments.size(); i++) {
+        const MomentState& m = snap.moments[i];
+        out << "moments " << m.set << " " << m.name << " " << m.entries << " " << m.sumw << " "
+            << m.sumw2 << " " << m.mean << " " << m.m2 << "\n";
+    }
+    for (unsigned int i = 0; i < snap.histos.size(); i++) {
+        out << "histo " << snap.histos[i].name << " " << snap.histos[i].bins.size() << "\n";
+        for (unsigned int b = 0; b < snap.histos[i].bins.size(); b++) {
+            const BinState& bin = snap.histos[i].bins[b];
+            out << bin.entries << " " << bin.sumw << " " << bin.sumw2 << " " << bin.sumxw << " " << bin.sumx2w << "\n";
+        }
+    }
+    out << "end\n";
+    out.close();
+    if (!out || std::rename(tmpName.c_str(), _fileName.c_str()) != 0) {
+        std::cerr << "Could not write checkpoint " << _fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AnalysisCheckpoint::read(Snapshot& snap) const {
+    std::ifstream in(_fileName.c_str());
+    if (!in) return false;
+    std::string tag, key;
+    int version = 0;
+    in >> tag >> version;
+    //versions 1 and 2 stored the bin mean and, from 2, the bin rms
+    if (tag != kCheckpointTag || version < 1 || version > kCheckpointVersion) {
+        std::cerr << _fileName << " is not a checkpoint file" << std::endl;
+        return false;
+    }
+    while (in >> key) {
+        if (key == "analysis") {
+            in >> snap.analysis;
+        } else if (key == "events") {
+            in >> snap.events;
+        } else if (key == "counter") {
+            CounterState counter;
+            unsigned int n = 0;
+            in >> counter.name >> n;
+            counter.values.resize(n);
+            for (unsigned int i = 0; i < n; i++) in >> counter.values[i];
+            snap.counters.push_back(counter);
+        } else if (key == "moments") {
+            MomentState m;
+            in >> m.set >> m.name >> m.entries >> m.sumw >> m.sumw2 >> m.mean >> m.m2;
+            snap.moments.push_back(m);
+        } else if (key == "histo") {
+            HistoState histo;
+            unsigned int n = 0;
+            in >> histo.name >> n;
+            histo.bins.resize(n);
+            for (unsigned int b = 0; b < n; b++) {
+                BinState& bin = histo.bins[b];
+                in >> bin.entries >> bin.sumw >> bin.sumw2;
+                if (version > 2) {
+                    in >> bin.sumxw >> bin.sumx2w;
+                    continue;
+                }
+                double mean = 0., rms = 0.;
+                in >> mean;
+                if (version > 1) in >> rms;
+                bin.sumxw = mean*bin.sumw;
+                bin.sumx2w = (rms*rms + mean*mean)*bin.sumw;
+            }
+            snap.histos.push_back(histo);
+        } else if (key == "end") {
+            return true;
+        } else {
+            break;
+        }
+    }
+    std::cerr << _fileName << " is truncated, ignoring it" << std::endl;
+    return false;
+}
+
+}
@@ -1,4 +1,9 @@
 #include "BOOSTFastJets.h"
+#include "ScratchArena.h"
+#include "AnalysisOptions.h"
+#include "KernelMath.h"
+#include "RunningMoments.h"
+#include <sstream>
 #include "Rivet/Tools/ParticleIdUtils.hh"
 #include "fastjet/tools/Filter.hh"
 #include "fastjet/tools/Pruner.hh"
@@ -42,7 +47,10 @@ double Dipolarity(const fastjet::PseudoJet &j) {
 ///\vec{t} ===\Sum_{i\in J} |r_i|p_{Ti}/p_{TJ}\vec{r_i}
 std::pair<double,double> JetPull(const FastJets& jetProjection, const fastjet::PseudoJet &j, const double ptmin) {
     assert(jetProjection.clusterSeq());
-    const PseudoJets parts = jetProjection.clusterSeq()->constituents(j);
+    return JetPull(j, jetProjection.clusterSeq()->constituents(j), ptmin);
+}
+
+std::pair<double,double> JetPull(const fastjet::PseudoJet &j, const PseudoJets& parts, const double ptmin) {
     const double jetRap = j.rapidity(), jetPhi = j.phi();
     double ty=0, tphi=0, tmag=0, ttheta=0, dphi=0;
     if(parts.size() > 1) {
@@ -67,19 +75,44 @@ std::pair<double,double> JetPull(const FastJets& jetProjection, const fastjet::P
 }
 
 ///Q===\Sum_{i\in J} q_i*p_{Ti}^k/p_{TJ}
+template <typename Real>
 double JetCharge(const FastJets& jetProjection, const fastjet::PseudoJet &j, const double k, const double ptmin) {
     assert(jetProjection.clusterSeq());
     const PseudoJets parts = jetProjection.clusterSeq()->constituents(j);
-    double q(0);
+    ScratchVector<double>::type charges;
+    charges.reserve(parts.size());
     foreach (const fastjet::PseudoJet& p, parts) {
         map<int, Particle>::const_iterator found = jetProjection.particles().find(p.user_index());
         assert(found != jetProjection.particles().end());
-        if(p.pt() < ptmin) continue; //pt always > 0, if the user hasn't defined a cut, this will always pass
-        q += PID::charge(found->second) * pow(p.pt(),k);
+        charges.push_back(PID::charge(found->second));
+    }
+    return JetCharge<Real>(j, parts, charges.empty() ? 0 : &charges[0], k, ptmin);
+}
+
+double JetCharge(const FastJets& jetProjection, const fastjet::PseudoJet &j, const double k, const double ptmin) {
+    return JetCharge<KernelReal>(jetProjection, j, k, ptmin);
+}
+
+template <typename Real>
+double JetCharge(const fastjet::PseudoJet &j, const PseudoJets& parts, const double* charges, const double k, const double ptmin) {
+    typedef KernelMath<Real> Math;
+    Real q(0);
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        if(parts[i].pt() < ptmin) continue; //pt always > 0, if the user hasn't defined a cut, this will always pass
+        q += Real(charges[i]) * Math::pow(parts[i].pt(),k);
     }
-    return q/pow(j.pt(),k);
+    return q/Math::pow(j.pt(),k);
 }
 
+double JetCharge(const fastjet::PseudoJet &j, const PseudoJets& parts, const double* charges, const double k, const double ptmin) {
+    return JetCharge<KernelReal>(j, parts, charges, k, ptmin);
+}
+
+template double JetCharge<float>(const FastJets&, const fastjet::PseudoJet&, const double, const double);
+template double JetCharge<double>(const FastJets&, const fastjet::PseudoJet&, const double, const double);
+template double JetCharge<float>(const fastjet::PseudoJet&, const PseudoJets&, const double*, const double, const double);
+template double JetCharge<double>(const fastjet::PseudoJet&, const PseudoJets&, const double*, const double, const double);
+
 fastjet::JetAlgorithm setJetAlgorithm(FastJets::JetAlgName subJetAlgorithm)
 {
     //Do we want to support all enums? This is only a subset...
@@ -133,7 +166,7 @@ fastjet::PseudoJet Pruner(const fastjet::ClusterSequence* clusterSeq, fastjet::P
 }
 
 PseudoJets GetAxes(const fastjet::ClusterSequence* clusterSeq, unsigned int n_jets,
-                   PseudoJets& inputJets, FastJets::JetAlgName subjet_def, double subR) {
+                   const PseudoJets& inputJets, FastJets::JetAlgName subjet_def, double subR) {
     assert(clusterSeq);
     //sanity check
     if (inputJets.size() < n_jets) {
@@ -145,29 +178,53 @@ PseudoJets GetAxes(const fastjet::ClusterSequence* clusterSeq, unsigned int n_je
     return sub_clust_seq.exclusive_jets((signed)n_jets);
 }
 
+template <typename Real>
 double TauValue(double beta, double jet_rad,
-                PseudoJets& particles, PseudoJets& axes) {
-    double tauNum = 0.0;
-    double tauDen = 0.0;
+                const PseudoJets& particles, const PseudoJets& axes) {
+    typedef KernelMath<Real> Math;
+    Real tauNum = 0.0;
+    Real tauDen = 0.0;
     if(particles.size() == 0)return 0.0;
+    //axes column-wise; distances as PseudoJet::squared_distance()
+    typename ScratchVector<Real>::type axisRap(axes.size()), axisPhi(axes.size());
+    for (unsigned int j = 0; j < axes.size(); j++) {
+        axisRap[j] = axes[j].rap();
+        axisPhi[j] = axes[j].phi();
+    }
+    const Real jetRadBeta = Math::pow(jet_rad,beta);
     for (unsigned int i = 0; i < particles.size(); i++) {
+        const Real rap = particles[i].rap();
+        const Real phi = particles[i].phi();
         // find minimum distance (set R large to begin)
-        double minR = 10000.0;
+        Real minR = 10000.0;
         for (unsigned int j = 0; j < axes.size(); j++) {
-            double tempR = sqrt(particles[i].squared_distance(axes[j]));
+            Real dphi = std::fabs(phi - axisPhi[j]);
+            dphi = dphi > Real(M_PI) ? Real(2*M_PI) - dphi : dphi;
+            const Real drap = rap - axisRap[j];
+            const Real tempR = std::sqrt(dphi*dphi + drap*drap);
             if (tempR < minR) minR = tempR;
         }
         //calculate nominator and denominator
-        tauNum += particles[i].perp() * pow(minR,beta);
-        tauDen += particles[i].perp() * pow(jet_rad,beta);
+        const Real pt = particles[i].perp();
+        tauNum += pt * Math::pow(minR,beta);
+        tauDen += pt * jetRadBeta;
     }
     //return N-subjettiness
     return tauNum/tauDen;
 }
 
+double TauValue(double beta, double jet_rad,
+                const PseudoJets& particles, const PseudoJets& axes) {
+    return TauValue<KernelReal>(beta, jet_rad, particles, axes);
+}
+
+template double TauValue<float>(double, double, const PseudoJets&, const PseudoJets&);
+template double TauValue<double>(double, double, const PseudoJets&, const PseudoJets&);
+
 void UpdateAxes(double beta,
-                PseudoJets& particles, PseudoJets& axes) {
-    vector<int> belongsto;
+                const PseudoJets& particles, PseudoJets& axes) {
+    ScratchVector<int>::type belongsto;
+    belongsto.reserve(particles.size());
     //no reason not to use foreach here
     for (unsigned int i = 0; i < particles.size(); i++) {
         // find minimum distance axis
@@ -184,7 +241,7 @@ void UpdateAxes(double beta,
     }
     // iterative step
     double deltaR2, distphi;
-    vector<double> ynom, phinom, den;
+    ScratchVector<double>::type ynom, phinom, den;
     ynom.resize(axes.size());
     phinom.resize(axes.size());
     den.resize(axes.size());
@@ -215,7 +272,7 @@ void UpdateAxes(double beta,
     }
 }
 
-double KeyColToRight(int p, vector<ACFpeak> peaks, vector<double> ASF_erf) {
+double KeyColToRight(int p, const vector<ACFpeak>& peaks, const double* ASF_erf) {
     int higherpeak = -1;
     double height = peaks[p].height;
     double keycol = height;
@@ -237,7 +294,7 @@ double KeyColToRight(int p, vector<ACFpeak> peaks, vector<double> ASF_erf) {
     return keycol;
 }
 
-double KeyColToLeft(int p, vector<ACFpeak> peaks, vector<double> ASF_erf) {
+double KeyColToLeft(int p, const vector<ACFpeak>& peaks, const double* ASF_erf) {
     int higherpeak = -1;
     double height = peaks[p].height;
     double keycol = height;
@@ -259,82 +316,410 @@ double KeyColToLeft(int p, vector<ACFpeak> peaks, vector<double> ASF_erf) {
     return keycol;
 }
 
-vector<ACFpeak> ASFPeaks(PseudoJets& particles,
-                         unsigned int most_prominent, double minprominence,
-                         double sigma, unsigned int meshsize, unsigned int normalisation) {
-    vector<ACFpeak> peaks;
+/// pT ordering of the constituents for the pair cache
+struct PtOrder {
+    explicit PtOrder(const PseudoJets& particles) : _particles(particles) {}
+    bool operator()(unsigned int a, unsigned int b) const { return _particles[a].perp() > _particles[b].perp(); }
+    const PseudoJets& _particles;
+};
+
+JetPairCache::JetPairCache(const PseudoJets& particles) {
+    const unsigned int n = particles.size();
+    ScratchVector<unsigned int>::type order(n);
+    for (unsigned int i = 0; i < n; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), PtOrder(particles));
+    _pt.resize(n);
+    ScratchVector<double>::type rap(n), phi(n);
+    for (unsigned int i = 0; i < n; i++) {
+        const fastjet::PseudoJet& p = particles[order[i]];
+        _pt[i] = p.perp();
+        rap[i] = p.rap();
+        phi[i] = p.phi();
+    }
+    //same as plain_distance(), which wraps dphi into [0, pi]
+    _dR.resize(n*n);
+    for (unsigned int i = 0; i < n; i++) {
+        _dR[i*n + i] = 0.;
+        for (unsigned int j = 0; j < i; j++) {
+            double dphi = fabs(phi[i] - phi[j]);
+            if (dphi > M_PI) dphi = 2*M_PI - dphi;
+            const double drap = rap[i] - rap[j];
+            _dR[i*n + j] = _dR[j*n + i] = sqrt(drap*drap + dphi*dphi);
+        }
+    }
+}
 
-    //sanity check
-    if(particles.size() < 2) {
-        cout << "Not enough particles in jet for ACF." << endl;
-        return peaks;
+/// Sum of a[k]*b[k], four independent partial sums so the loop pipelines
+/// and vectorises without reassociation by the compiler
+static inline double Dot(const double* a, const double* b, unsigned int n) {
+    double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+    unsigned int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        s0 += a[k]*b[k];
+        s1 += a[k+1]*b[k+1];
+        s2 += a[k+2]*b[k+2];
+        s3 += a[k+3]*b[k+3];
+    }
+    for (; k < n; k++) s0 += a[k]*b[k];
+    return (s0 + s1) + (s2 + s3);
+}
+
+/// Factorial up to 4 for the truncation bounds
+static double Factorial(unsigned int n) { return n < 2 ? 1. : n*Factorial(n-1); }
+
+ECFResult EnergyCorrelations(const JetPairCache& cache, double beta,
+                             unsigned int maxN) {
+    ECFResult result;
+    result.e2 = result.e3 = result.e4 = 0.;
+    result.e2Error = result.e3Error = result.e4Error = 0.;
+    result.C2 = result.D2 = result.C3 = 0.;
+    const unsigned int n = cache.size();
+    if (n < 2) return result;
+
+    double sumPt = 0.;
+    for (unsigned int i = 0; i < n; i++) sumPt += cache.pt(i);
+    if (sumPt <= 0.) return result;
+    ScratchVector<double>::type z(n);
+    for (unsigned int i = 0; i < n; i++) z[i] = cache.pt(i)/sumPt;
+
+    //dR^beta, straight from the cache for beta = 1
+    const double* d = cache.row(0);
+    ScratchVector<double>::type powered;
+    if (beta != 1.) {
+        powered.resize(n*n);
+        for (unsigned int i = 0; i < n*n; i++) powered[i] = pow(d[i], beta);
+        d = &powered[0];
+    }
+    double dMax = 0.;
+    for (unsigned int i = 0; i < n*n; i++) dMax = std::max(dMax, d[i]);
+
+    //every e_N over the same nc hardest particles
+    const unsigned int nc = (maxN == 0 || maxN > n) ? n : maxN;
+    for (unsigned int i = 0; i < nc; i++)
+        result.e2 += z[i]*Dot(&z[0] + i+1, d + i*n + i+1, nc-i-1);
+
+    //e3 = sum_{i<j} z_i z_j d_ij sum_{k>j} (z_k d_ik) d_jk. Rows of z_k d_ik
+    //are built for a block of i, so each row d_j is streamed once per block.
+    const unsigned int n3 = nc;
+    const unsigned int block = 8;
+    ScratchVector<double>::type zd(block*n3);
+    for (unsigned int i0 = 0; i0 < n3; i0 += block) {
+        const unsigned int i1 = std::min(n3, i0 + block);
+        for (unsigned int i = i0; i < i1; i++)
+            for (unsigned int k = 0; k < n3; k++) zd[(i-i0)*n3 + k] = z[k]*d[i*n + k];
+        for (unsigned int j = i0 + 1; j < n3; j++) {
+            const double* dj = &d[j*n];
+            for (unsigned int i = i0; i < i1 && i < j; i++) {
+                const double wij = z[i]*z[j]*d[i*n + j];
+                if (wij == 0.) continue;
+                result.e3 += wij*Dot(&zd[0] + (i-i0)*n3 + j+1, dj + j+1, n3-j-1);
+            }
+        }
+    }
+
+    //e4 = sum_{i<j<k} z_i z_j z_k d_ij d_ik d_jk sum_{l>k} (z_l d_il d_jl) d_kl.
+    //For each j the rows of z_l d_il d_jl are built for a block of i, so
+    //each row d_k is streamed once per block, as for e3.
+    const unsigned int n4 = nc;
+    ScratchVector<double>::type zdd(block*n4);
+    for (unsigned int j = 1; j < n4; j++) {
+        const double* dj = &d[j*n];
+        for (unsigned int i0 = 0; i0 < j; i0 += block) {
+            const unsigned int i1 = std::min(j, i0 + block);
+            for (unsigned int i = i0; i < i1; i++)
+                for (unsigned int l = j+1; l < n4; l++) zdd[(i-i0)*n4 + l] = z[l]*d[i*n + l]*dj[l];
+            for (unsigned int k = j+1; k + 1 < n4; k++) {
+                const double* dk = &d[k*n];
+                for (unsigned int i = i0; i < i1; i++) {
+                    const double wijk = z[i]*z[j]*d[i*n + j]*z[k]*d[i*n + k]*dj[k];
+                    if (wijk == 0.) continue;
+                    result.e4 += wijk*Dot(&zdd[0] + (i-i0)*n4 + k+1, dk + k+1, n4-k-1);
+                }
+            }
+        }
+    }
+
+    //every left out N-tuple contains a particle beyond the cut, so the
+    //missing part is at most dMax^(N(N-1)/2) (1 - (sum_{i<cut} z_i)^N)/N!
+    if (nc < n) {
+        double zIn = 0.;
+        for (unsigned int i = 0; i < nc; i++) zIn += z[i];
+        result.e2Error = dMax*(1. - zIn*zIn)/Factorial(2);
+        result.e3Error = pow(dMax, 3)*(1. - pow(zIn, 3))/Factorial(3);
+        result.e4Error = pow(dMax, 6)*(1. - pow(zIn, 4))/Factorial(4);
+    }
+
+    if (result.e2 > 0.) {
+        result.C2 = result.e3/(result.e2*result.e2);
+        result.D2 = result.e3/(result.e2*result.e2*result.e2);
+    }
+    if (result.e3 > 0.) result.C3 = result.e4*result.e2/(result.e3*result.e3);
+    return result;
+}
+
+/// Ascending pT ordering, softest first
+struct SoftFirst {
+    explicit SoftFirst(const PseudoJets& particles) : _particles(particles) {}
+    bool operator()(unsigned int a, unsigned int b) const { return _particles[a].perp() < _particles[b].perp(); }
+    const PseudoJets& _particles;
+};
+
+ThinningReport ThinConstituents(const PseudoJets& in, PseudoJets& out, const ThinningSettings& settings) {
+    ThinningReport report;
+    report.before = report.after = in.size();
+    report.mergedFraction = 0.;
+    out.clear();
+    if (in.size() <= settings.threshold) {
+        out = in;
+        return report;
     }
-    //pair all particles up
-    vector<ACFparticlepair> pairs;
+
+    double sumPt = 0.;
+    for (unsigned int i = 0; i < in.size(); i++) sumPt += in[i].perp();
+    ScratchVector<unsigned int>::type order(in.size());
+    for (unsigned int i = 0; i < in.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), SoftFirst(in));
+
+    //softest first, each either joins the nearest cluster within mergeR or
+    //seeds a new one; all of them count against the budget
+    const double mergeR2 = settings.mergeR*settings.mergeR;
+    PseudoJets clusters;
+    unsigned int count = in.size();
+    double merged = 0.;
+    unsigned int next = 0;
+    for (; next < order.size() && count > settings.threshold; next++) {
+        const fastjet::PseudoJet& p = in[order[next]];
+        if (merged + p.perp() > settings.budget*sumPt) break;
+        merged += p.perp();
+        int nearest = -1;
+        double nearestR2 = mergeR2;
+        for (unsigned int c = 0; c < clusters.size(); c++) {
+            const double r2 = p.squared_distance(clusters[c]);
+            if (r2 < nearestR2) {
+                nearestR2 = r2;
+                nearest = c;
+            }
+        }
+        if (nearest < 0) {
+            clusters.push_back(p);
+        } else {
+            clusters[nearest] += p;
+            count--;
+        }
+    }
+
+    out.reserve(count);
+    for (unsigned int i = next; i < order.size(); i++) out.push_back(in[order[i]]);
+    out.insert(out.end(), clusters.begin(), clusters.end());
+    report.after = out.size();
+    report.mergedFraction = sumPt > 0. ? merged/sumPt : 0.;
+    return report;
+}
+
+ConstituentThinning::ConstituentThinning()
+    : _validate(false), _thinned(false), _jets(0), _thinnedJets(0), _before(0), _after(0), _maxFraction(0.) {
+    _settings.budget = 0.;
+    _settings.mergeR = 0.1;
+    _settings.threshold = 100;
+}
+
+void ConstituentThinning::configure(const std::string& tag) {
+    _settings.budget = OptionDouble(tag + "_THIN_BUDGET", 0.);
+    _settings.mergeR = OptionDouble(tag + "_THIN_R", 0.1);
+    _settings.threshold = OptionInt(tag + "_THIN_ABOVE", 100);
+    _validate = OptionInt(tag + "_THIN_VALIDATE", 0) != 0;
+}
+
+const PseudoJets& ConstituentThinning::apply(const PseudoJets& constituents) {
+    _thinned = false;
+    if (!enabled() || constituents.size() <= _settings.threshold) return constituents;
+    const ThinningReport report = ThinConstituents(constituents, _output, _settings);
+    _jets++;
+    if (report.after == report.before) return constituents;
+    _thinned = true;
+    _thinnedJets++;
+    _before += report.before;
+    _after += report.after;
+    _maxFraction = std::max(_maxFraction, report.mergedFraction);
+    return _output;
+}
+
+void ConstituentThinning::compare(const std::string& observable, double thinnedValue, double fullValue) {
+    if (!_thinned) return;
+    double& change = _maxChange[observable];
+    change = std::max(change, fabs(thinnedValue - fullValue));
+}
+
+void ConstituentThinning::print(std::ostream& os, const std::string& analysis) const {
+    if (!enabled()) return;
+    os << analysis << ": thinned " << _thinnedJets << " of " << _jets << " jets above "
+       << _settings.threshold << " constituents";
+    if (_thinnedJets > 0)
+        os << ", " << _before/(double)_thinnedJets << " -> " << _after/(double)_thinnedJets
+           << " constituents on average, at most " << _maxFraction << " of the pT merged";
+    os << endl;
+    for (std::map<std::string, double>::const_iterator it = _maxChange.begin(); it != _maxChange.end(); ++it)
+        os << "  largest change of " << it->first << ": " << it->second << endl;
+}
+
+void PrintECFTruncation(std::ostream& os, const MomentSet& moments, unsigned int maxN) {
+    const MomentSet::Map& m = moments.moments();
+    const char* orders[3] = {"e2", "e3", "e4"};
+    for (unsigned int i = 0; i < 3; i++) {
+        const MomentSet::Map::const_iterator value = m.find(std::string("ECF_") + orders[i]);
+        const MomentSet::Map::const_iterator error = m.find(std::string("ECF_") + orders[i] + "Error");
+        if (value == m.end() || error == m.end()) continue;
+        os << "ECF " << orders[i] << " over the ";
+        if (maxN > 0) os << maxN << " hardest";
+        else os << "all";
+        os << " constituents: mean " << value->second.mean() << ", mean bound on the omitted part "
+           << error->second.mean() << endl;
+    }
+}
+
+PrecisionCheck::PrecisionCheck()
+    : _requested(false), _validate(false), _tolerance(0.1), _compared(0) {}
+
+void PrecisionCheck::configure() {
+    _requested = OptionInt("PRECISION_VALIDATE", 0) != 0;
+    //nothing to compare in a double build
+    _validate = _requested && sizeof(KernelReal) < sizeof(double);
+    _tolerance = OptionDouble("PRECISION_TOLERANCE", 0.1);
+}
+
+void PrecisionCheck::compare(const std::string& histogram, double binWidth, double value, double reference) {
+    _compared++;
+    double& deviation = _maxDeviation[histogram];
+    deviation = std::max(deviation, fabs(value - reference)/binWidth);
+}
+
+double PrecisionCheck::maxDeviation() const {
+    double deviation = 0.;
+    for (std::map<std::string, double>::const_iterator it = _maxDeviation.begin(); it != _maxDeviation.end(); ++it)
+        deviation = std::max(deviation, it->second);
+    return deviation;
+}
+
+void PrecisionCheck::print(std::ostream& os, const std::string& analysis) const {
+    if (_requested && !_validate)
+        os << analysis << ": JETSTUDY_PRECISION_VALIDATE needs a build with make PRECISION=float" << endl;
+    if (!_validate) return;
+    os << analysis << ": float kernels against double, " << _compared << " values, largest deviation in bin widths"
+       << " (tolerance " << _tolerance << ")" << endl;
+    for (std::map<std::string, double>::const_iterator it = _maxDeviation.begin(); it != _maxDeviation.end(); ++it)
+        os << "  " << it->first << ": " << it->second << (it->second > _tolerance ? "  ABOVE TOLERANCE" : "") << endl;
+    os << "  " << (maxDeviation() > _tolerance ? "float kernels are NOT within tolerance" : "float kernels are within tolerance")
+       << endl;
+}
+
+/// All particle pairs for the ASF, sorted by delta R
+static void BuildPairs(const JetPairCache& cache, ScratchVector<ACFparticlepair>::type& pairs) {
+    pairs.reserve(cache.size()*(cache.size()-1)/2);
     ACFparticlepair dummy;
-    for(unsigned int k = 0; k < particles.size(); k++) {
+    for(unsigned int k = 0; k < cache.size(); k++) {
         for(unsigned int j = 0; j < k; j++) {
-            double phidist = abs(particles[k].phi_std() - particles[j].phi_std());
-            if( phidist > M_PI ) phidist = 2 * M_PI - phidist;
-            //dummy.deltaR = sqrt( pow(particles[k].pseudorapidity() - particles[j].pseudorapidity(), 2) +
-            //	pow(phidist, 2) );
-            dummy.deltaR = sqrt(particles[k].plain_distance(particles[j]));
-            dummy.weight = particles[k].perp() * particles[j].perp() * dummy.deltaR * dummy.deltaR;
+            dummy.deltaR = cache.deltaR(k, j);
+            dummy.weight = cache.pt(k) * cache.pt(j) * dummy.deltaR * dummy.deltaR;
             pairs.push_back(dummy);
         }
     }
-
-    //sort by delta R
     sort(pairs.begin(), pairs.end(), ppsortfunction());
+}
 
-    double Rmax = pairs[pairs.size() - 1].deltaR;
-
-    double rVal = 0.;
-    double xArg = 0.;
-    vector<double> ACF(meshsize), ASF_gauss(meshsize), Rvals(meshsize), erf_denom(meshsize), gauss_peak(meshsize);
-    ACF[0] = 0.;
-    ASF_gauss[0] = 0.;
-    Rvals[0] = 0.;
-    erf_denom[0] = 0.;
-    gauss_peak[0] = 0.;
-    double fVal = 0.;
-    double eVal = 0.;
-    double gVal = 0.;
+/// The mesh loop of the ASF at precision Real: for every mesh point k > 0,
+/// R value, ACF (weight of the pairs within R), error function smoothed
+/// ACF and Gaussian peak sum. The terms of all pairs are computed in one
+/// loop without dependencies, which vectorises in the float build, and
+/// summed in double in pair order, so the double kernel adds exactly as
+/// the original loop did.
+template <typename Real>
+static void ASFMesh(const ScratchVector<ACFparticlepair>::type& pairs, double Rmax, double sigma,
+                    unsigned int meshsize, double* Rvals, double* ACF, double* erf_denom, double* gauss_peak) {
+    typedef KernelMath<Real> Math;
+    const unsigned int n = pairs.size();
+    //the pairs column-wise, and the terms of one mesh point
+    typename ScratchVector<Real>::type dR(n), weight(n), fTerm(n), eTerm(n), gTerm(n);
+    for (unsigned int j = 0; j < n; j++) {
+        dR[j] = pairs[j].deltaR;
+        weight[j] = pairs[j].weight;
+    }
+    const Real s = sigma;
 
-    //mesh loop
     for (unsigned int k = 1; k < meshsize; k++) {
-
-        rVal = (double)k*Rmax/(meshsize-1);
+        const double rVal = (double)k*Rmax/(meshsize-1);
         Rvals[k] = rVal;
-
-        //reset
-        fVal = 0.;
-        eVal = 0.;
-        gVal = 0.;
+        const Real r = rVal;
 
         //Loop on pairs.
-        for (unsigned int j = 0; j < pairs.size(); j++) {
+        for (unsigned int j = 0; j < n; j++) {
+            const Real w = weight[j];
             //ACF-Add pairs within mesh's deltaR.
-            if (pairs[j].deltaR <= rVal) fVal += pairs[j].weight;
+            fTerm[j] = dR[j] <= r ? w : Real(0);
 
             //Smoothing function argument
-            xArg = (double)(rVal-pairs[j].deltaR)/sigma;
+            const Real xArg = (r - dR[j])/s;
 
             //ASF Error Function Denominator: Add pairs weighted by Erf values.
-            eVal += (double)pairs[j].weight*0.5*(1.0+erf(xArg));
+            eTerm[j] = w*Real(0.5)*(Real(1)+Math::erf(xArg));
 
             //ASF Gaussian Numerator: Add pairs weight by Gaussian values.
-            gVal += (double)pairs[j].weight * (exp( -pow ((abs(xArg)),2.0)));
-
+            gTerm[j] = w*Math::gauss(xArg);
         }//end pair loop
+
+        double fVal = 0., eVal = 0., gVal = 0.;
+        for (unsigned int j = 0; j < n; j++) {
+            fVal += fTerm[j];
+            eVal += eTerm[j];
+            gVal += gTerm[j];
+        }
         ACF[k] = fVal;
         erf_denom[k] = eVal;
         gauss_peak[k] = gVal;
-        ASF_gauss[k] = (double)gVal*(1/sqrt(M_PI))*rVal/sigma; //Normalized Gaussian value
-
     }//end mesh loop
+}
+
+vector<ACFpeak> ASFPeaks(const PseudoJets& particles,
+                         unsigned int most_prominent, double minprominence,
+                         double sigma, unsigned int meshsize, unsigned int normalisation) {
+    const JetPairCache cache(particles);
+    return ASFPeaks(cache, most_prominent, minprominence, sigma, meshsize, normalisation);
+}
+
+vector<ACFpeak> ASFPeaks(const JetPairCache& cache,
+                         unsigned int most_prominent, double minprominence,
+                         double sigma, unsigned int meshsize, unsigned int normalisation) {
+    return ASFPeaks<KernelReal>(cache, most_prominent, minprominence, sigma, meshsize, normalisation);
+}
+
+template <typename Real>
+vector<ACFpeak> ASFPeaks(const JetPairCache& cache,
+                         unsigned int most_prominent, double minprominence,
+                         double sigma, unsigned int meshsize, unsigned int normalisation) {
+    vector<ACFpeak> peaks;
+
+    //sanity check
+    if(cache.size() < 2) {
+        cout << "Not enough particles in jet for ACF." << endl;
+        return peaks;
+    }
+    //pair all particles up, sorted by delta R
+    ScratchVector<ACFparticlepair>::type pairs;
+    BuildPairs(cache, pairs);
+
+    double Rmax = pairs[pairs.size() - 1].deltaR;
+
+    ScratchVector<double>::type ACF(meshsize), ASF_gauss(meshsize), Rvals(meshsize), erf_denom(meshsize), gauss_peak(meshsize);
+    ACF[0] = 0.;
+    ASF_gauss[0] = 0.;
+    Rvals[0] = 0.;
+    erf_denom[0] = 0.;
+    gauss_peak[0] = 0.;
+    //mesh loop
+    ASFMesh<Real>(pairs, Rmax, sigma, meshsize, &Rvals[0], &ACF[0], &erf_denom[0], &gauss_peak[0]);
+    for (unsigned int k = 1; k < meshsize; k++)
+        ASF_gauss[k] = (double)gauss_peak[k]*(1/sqrt(M_PI))*Rvals[k]/sigma; //Normalized Gaussian value
 
-    vector<double> ASF_erf(meshsize), ASF(meshsize);
+    ScratchVector<double>::type ASF_erf(meshsize), ASF(meshsize);
     ASF[0] = 0.;
     ASF[meshsize-1] = 0.;
     ASF_erf[0] = 0.;
@@ -391,8 +776,8 @@ vector<ACFpeak> ASFPeaks(PseudoJets& particles,
     //Prominence of peak
     for (unsigned int k = 0; k < peaks.size(); k++) {
         double height = peaks[k].height;
-        double leftdescent = height - KeyColToLeft(k, peaks, ASF_erf);
-        double rightdescent = height - KeyColToRight(k, peaks, ASF_erf);
+        double leftdescent = height - KeyColToLeft(k, peaks, &ASF_erf[0]);
+        double rightdescent = height - KeyColToRight(k, peaks, &ASF_erf[0]);
         if (leftdescent < rightdescent) peaks[k].prominence = leftdescent;
         else peaks[k].prominence = rightdescent;
     }
@@ -440,86 +825,256 @@ vector<ACFpeak> ASFPeaks(PseudoJets& particles,
     }
 }
 
-vector<vector<double> > ASF(PseudoJets& particles,
+template vector<ACFpeak> ASFPeaks<float>(const JetPairCache&, unsigned int, double, double, unsigned int, unsigned int);
+template vector<ACFpeak> ASFPeaks<double>(const JetPairCache&, unsigned int, double, double, unsigned int, unsigned int);
+
+vector<vector<double> > ASF(const PseudoJets& particles,
+                double sigma, unsigned int meshsize, unsigned int normalisation) {
+    const JetPairCache cache(particles);
+    return ASF(cache, sigma, meshsize, normalisation);
+}
+
+vector<vector<double> > ASF(const JetPairCache& cache,
+                double sigma, unsigned int meshsize, unsigned int normalisation) {
+    return ASF<KernelReal>(cache, sigma, meshsize, normalisation);
+}
+
+template <typename Real>
+vector<vector<double> > ASF(const JetPairCache& cache,
                 double sigma, unsigned int meshsize, unsigned int normalisation) {
 
     vector<vector<double> > functions;
 
     //sanity check
-    if(particles.size() < 2) {
+    if(cache.size() < 2) {
         cout << "Not enough particles in jet for ACF." << endl;
         return functions;
     }
-    //pair all particles up
-    vector<ACFparticlepair> pairs;
-    ACFparticlepair dummy;
-    for(unsigned int k = 0; k < particles.size(); k++) {
-        for(unsigned int j = 0; j < k; j++) {
-            double phidist = abs(particles[k].phi_std() - particles[j].phi_std());
-            if( phidist > M_PI ) phidist = 2 * M_PI - phidist;
-            //dummy.deltaR = sqrt( pow(particles[k].pseudorapidity() - particles[j].pseudorapidity(), 2) +
-            //	pow(phidist, 2) );
-            dummy.deltaR = sqrt(particles[k].plain_distance(particles[j]));
-            dummy.weight = particles[k].perp() * particles[j].perp() * dummy.deltaR * dummy.deltaR;
-            pairs.push_back(dummy);
-        }
-    }
-
-    //sort by delta R
-    sort(pairs.begin(), pairs.end(), ppsortfunction());
+    //pair all particles up, sorted by delta R
+    ScratchVector<ACFparticlepair>::type pairs;
+    BuildPairs(cache, pairs);
 
     double Rmax = pairs[pairs.size() - 1].deltaR;
 
-    double rVal = 0.;
-    double xArg = 0.;
-    vector<double> ACF(meshsize), ASF_gauss(meshsize), Rvals(meshsize), erf_denom(meshsize), gauss_peak(meshsize);
+    functions.assign(3, vector<double>(meshsize));
+    vector<double>& Rvals = functions[0];
+    vector<double>& ASF_gauss = functions[1];
+    ScratchVector<double>::type ACF(meshsize), erf_denom(meshsize), gauss_peak(meshsize);
     ACF[0] = 0.;
     ASF_gauss[0] = 0.;
     Rvals[0] = 0.;
     erf_denom[0] = 0.;
     gauss_peak[0] = 0.;
-    double fVal = 0.;
-    double eVal = 0.;
-    double gVal = 0.;
-
     //mesh loop
-    for (unsigned int k = 1; k < meshsize; k++) {
+    ASFMesh<Real>(pairs, Rmax, sigma, meshsize, &Rvals[0], &ACF[0], &erf_denom[0], &gauss_peak[0]);
+    for (unsigned int k = 1; k < meshsize; k++)
+        ASF_gauss[k] = (double)gauss_peak[k]*(1/sqrt(M_PI))*Rvals[k]/sigma; //Normalized Gaussian value
+    if(normalisation == 0) functions[2].assign(erf_denom.begin(), erf_denom.end());
+    else functions[2].assign(ACF.begin(), ACF.end());
 
-        rVal = (double)k*Rmax/(meshsize-1);
-        Rvals[k] = rVal;
+    return functions;
+}
 
-        //reset
-        fVal = 0.;
-        eVal = 0.;
-        gVal = 0.;
+template vector<vector<double> > ASF<float>(const JetPairCache&, double, unsigned int, unsigned int);
+template vector<vector<double> > ASF<double>(const JetPairCache&, double, unsigned int, unsigned int);
 
-        //Loop on pairs.
-        for (unsigned int j = 0; j < pairs.size(); j++) {
-            //ACF-Add pairs within mesh's deltaR.
-            if (pairs[j].deltaR <= rVal) fVal += pairs[j].weight;
+void SelectJets(const FastJets& jetProjection, double ptmin, double mmin, double mmax,
+                unsigned int maxJets, SelectedJets& selected) {
+    SelectJets(jetProjection, jetProjection.pseudoJetsByPt(ptmin), mmin, mmax, maxJets, selected);
+}
 
-            //Smoothing function argument
-            xArg = (double)(rVal-pairs[j].deltaR)/sigma;
+void SelectJets(const FastJets& jetProjection, const PseudoJets& candidates, double mmin, double mmax,
+                unsigned int maxJets, SelectedJets& selected) {
+    selected.clear();
+    foreach (const fastjet::PseudoJet& pjet, candidates) {
+        if (selected.size() >= maxJets) break;
+        if (pjet.m() <= mmin || pjet.m() >= mmax) continue;
+        selected.push_back(SelectedJet());
+        SelectedJet& jet = selected.back();
+        jet.pseudoJet = pjet;
+        jet.constituents = pjet.constituents();
+        //same particles, and momentum sum, as FastJets::jetsByPt() would give
+        jet.particles.reserve(jet.constituents.size());
+        foreach (const fastjet::PseudoJet& c, jet.constituents) {
+            map<int, Particle>::const_iterator found = jetProjection.particles().find(c.user_index());
+            assert(found != jetProjection.particles().end());
+            jet.particles.push_back(found->second);
+            jet.momentum += found->second.momentum();
+        }
+    }
+}
 
-            //ASF Error Function Denominator: Add pairs weighted by Erf values.
-            eVal += (double)pairs[j].weight*0.5*(1.0+erf(xArg));
+void MultiRadiusJets::configure(const std::string& tag) {
+    vector<double> radii;
+    foreach (const std::string& r, OptionList(tag + "_RADII")) radii.push_back(std::atof(r.c_str()));
+    setRadii(radii);
+}
 
-            //ASF Gaussian Numerator: Add pairs weight by Gaussian values.
-            gVal += (double)pairs[j].weight * (exp( -pow ((abs(xArg)),2.0)));
+void MultiRadiusJets::setRadii(const vector<double>& radii) {
+    _radii.clear();
+    foreach (double r, radii) if (r > 0.) _radii.push_back(r);
+    std::sort(_radii.begin(), _radii.end());
+    _radii.erase(std::unique(_radii.begin(), _radii.end()), _radii.end());
+}
 
-        }//end pair loop
-        ACF[k] = fVal;
-        erf_denom[k] = eVal;
-        gauss_peak[k] = gVal;
-        ASF_gauss[k] = (double)gVal*(1/sqrt(M_PI))*rVal/sigma; //Normalized Gaussian value
+std::string MultiRadiusJets::suffix(unsigned int i) const {
+    std::ostringstream name;
+    const int tenths = (int)floor(10*_radii[i] + 0.5);
+    name << "_R" << tenths/10 << tenths%10;
+    return name.str();
+}
 
-    }//end mesh loop
-    functions.push_back(Rvals);
-    functions.push_back(ASF_gauss);
-    if(normalisation == 0) functions.push_back(erf_denom);
-    else functions.push_back(ACF);
+void MultiRadiusJets::jets(const FastJets& camJets, unsigned int i, double ptmin, PseudoJets& out) const {
+    out.clear();
+    const fastjet::ClusterSequence* cs = camJets.clusterSeq();
+    if (!cs) return;
+    if (_radii[i] >= maxRadius()) {
+        out = fastjet::sorted_by_pt(cs->inclusive_jets(ptmin));
+        return;
+    }
+    const double dcut = sqr(_radii[i]/maxRadius());
+    const PseudoJets exclusive = cs->exclusive_jets(dcut);
+    foreach (const fastjet::PseudoJet& jet, exclusive)
+        if (jet.perp() >= ptmin) out.push_back(jet);
+    out = fastjet::sorted_by_pt(out);
+}
 
-    return functions;
+void ThresholdScan::configure(const std::string& tag) {
+    vector<double> thresholds;
+    foreach (const std::string& t, OptionList(tag + "_PTMIN_SCAN")) thresholds.push_back(std::atof(t.c_str())*GeV);
+    setThresholds(thresholds);
+}
+
+void ThresholdScan::setThresholds(const vector<double>& thresholds) {
+    _thresholds = thresholds;
+    std::sort(_thresholds.begin(), _thresholds.end());
+    _thresholds.erase(std::unique(_thresholds.begin(), _thresholds.end()), _thresholds.end());
+}
+
+std::string ThresholdScan::suffix(unsigned int i) const {
+    std::ostringstream name;
+    const int tenths = (int)floor(10*_thresholds[i]/GeV + 0.5);
+    name << "_PT" << tenths/10 << tenths%10;
+    return name.str();
+}
+
+void ThresholdScan::compute(const FastJets& jetProjection, const fastjet::PseudoJet& j, const vector<double>& kappas) {
+    typedef KernelMath<KernelReal> Math;
+    assert(jetProjection.clusterSeq());
+    const PseudoJets parts = jetProjection.clusterSeq()->constituents(j);
+    const unsigned int n = parts.size(), nT = _thresholds.size(), nK = kappas.size();
+    ScratchVector<std::pair<double, unsigned int> >::type order(n);
+    for (unsigned int i = 0; i < n; i++) order[i] = std::make_pair(parts[i].pt(), i);
+    std::sort(order.begin(), order.end());
+
+    //per constituent terms in ascending pT, summed from the hardest down;
+    //entry i holds the sum over constituents i..n-1
+    const double jetRap = j.rapidity(), jetPhi = j.phi();
+    fastjet::PseudoJet jet1, jet2;
+    const bool hasAxis = j.has_parents(jet1, jet2);
+    //as Dipolarity(), whose dphi is always zero
+    const double deta = hasAxis ? jet2.eta() - jet1.eta() : 0.;
+    const double dphi = hasAxis ? mapAngleMPiToPi(jet2.phi() - jet2.phi()) : 0.;
+    const double dmag2 = deta*deta + dphi*dphi;
+    const bool dipolar = hasAxis && dmag2 >= 1e-3;
+    const double dmag = sqrt(dmag2);
+    ScratchVector<double>::type ty(n + 1, 0.), tphi(n + 1, 0.), sumpt(n + 1, 0.), dip(n + 1, 0.), q((n + 1)*nK, 0.);
+    for (unsigned int i = n; i-- > 0; ) {
+        const fastjet::PseudoJet& p = parts[order[i].second];
+        const double pt = order[i].first;
+        const double prap = p.rapidity() - jetRap, pphi = mapAngleMPiToPi(p.phi() - jetPhi);
+        const double ptTimesRmag = sqrt(prap*prap + pphi*pphi)*pt;
+        ty[i] = ty[i+1] + ptTimesRmag*prap;
+        tphi[i] = tphi[i+1] + ptTimesRmag*pphi;
+
+        sumpt[i] = sumpt[i+1] + pt;
+        double d = 0.;
+        if (dipolar) {
+            double vx = p.eta() - jet1.eta(), vy = mapAngleMPiToPi(p.phi() - jet1.phi());
+            const double project = (vx*deta + vy*dphi)/dmag;
+            if (project > 0 && project < dmag) {
+                d = (vx*dphi - vy*deta)/dmag;
+                d *= d;
+            } else {
+                if (project > 0) {
+                    vx = p.eta() - jet2.eta();
+                    vy = mapAngleMPiToPi(p.phi() - jet2.phi());
+                }
+                d = vx*vx + vy*vy;
+            }
+        }
+        dip[i] = dip[i+1] + pt*d;
+
+        map<int, Particle>::const_iterator found = jetProjection.particles().find(p.user_index());
+        assert(found != jetProjection.particles().end());
+        const double charge = PID::charge(found->second);
+        for (unsigned int k = 0; k < nK; k++)
+            q[i*nK + k] = q[(i+1)*nK + k] + charge*Math::pow(pt, kappas[k]);
+    }
+
+    _pull.assign(nT, std::make_pair(0., 0.));
+    _charge.assign(nK*nT, 0.);
+    _dipolarity.assign(nT, -1.);
+    //thresholds ascend, so the first constituent above each only moves up
+    unsigned int above = 0, atOrAbove = 0;
+    for (unsigned int t = 0; t < nT; t++) {
+        const double ptmin = _thresholds[t];
+        while (atOrAbove < n && order[atOrAbove].first < ptmin) atOrAbove++;
+        if (above < atOrAbove) above = atOrAbove;
+        while (above < n && order[above].first <= ptmin) above++;
+        if (n > 1) {
+            double tmag = sqrt(ty[above]*ty[above] + tphi[above]*tphi[above])/j.pt();
+            const double ttheta = tmag > 0 ? atan2(tphi[above], ty[above]) : 0.;
+            if (tmag > 0.08) tmag = -1.0;
+            _pull[t] = std::make_pair(tmag, ttheta);
+        }
+        for (unsigned int k = 0; k < nK; k++)
+            _charge[k*nT + t] = q[atOrAbove*nK + k]/Math::pow(j.pt(), kappas[k]);
+        if (dipolar && sumpt[above] >= 1e-3) _dipolarity[t] = dip[above]/(sumpt[above]*dmag2);
+    }
+}
+
+/// Towers of cellSize x cellSize in (y, phi). A disc of radius R fits in a
+/// square of kY x kPhi towers wherever it is centred, so the largest sum
+/// over such windows bounds the scalar pT within any disc of radius R.
+double MaxConePt(const ParticleVector& particles, double R, double yMax, double cellSize) {
+    const int nY = std::max(1, (int)ceil(2*yMax/cellSize));
+    const int nPhi = std::max(1, (int)ceil(TWOPI/cellSize));
+    const double dY = 2*yMax/nY, dPhi = TWOPI/nPhi;
+    const int kY = std::min(nY, (int)ceil(2*R/dY) + 1);
+    const int kPhi = std::min(nPhi, (int)ceil(2*R/dPhi) + 1);
+
+    vector<double> towers(nY*nPhi, 0.);
+    foreach (const Particle& p, particles) {
+        //particles beyond the grid go to the edge towers, which only loosens the bound
+        const int iy = std::max(0, std::min(nY-1, (int)floor((p.momentum().rapidity()+yMax)/dY)));
+        const int iphi = std::min(nPhi-1, (int)floor(mapAngle0To2Pi(p.momentum().phi())/dPhi));
+        towers[iy*nPhi + iphi] += p.momentum().pT();
+    }
+
+    //sliding window in phi, wrapping around
+    vector<double> rows(nY*nPhi, 0.);
+    for (int iy = 0; iy < nY; iy++) {
+        const double* tower = &towers[iy*nPhi];
+        double sum = 0.;
+        for (int k = 0; k < kPhi; k++) sum += tower[k];
+        for (int iphi = 0; iphi < nPhi; iphi++) {
+            rows[iy*nPhi + iphi] = sum;
+            sum += tower[(iphi + kPhi) % nPhi] - tower[iphi];
+        }
+    }
+    //then in y, windows stop at the edges of the grid
+    double maxPt = 0.;
+    for (int iphi = 0; iphi < nPhi; iphi++) {
+        double sum = 0.;
+        for (int k = 0; k < kY; k++) sum += rows[k*nPhi + iphi];
+        maxPt = std::max(maxPt, sum);
+        for (int iy = kY; iy < nY; iy++) {
+            sum += rows[iy*nPhi + iphi] - rows[(iy-kY)*nPhi + iphi];
+            maxPt = std::max(maxPt, sum);
+        }
+    }
+    return maxPt;
 }
 
 }
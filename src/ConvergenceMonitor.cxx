@@ -0,0 +1,107 @@
+#include "ConvergenceMonitor.h"
+#include "AnalysisOptions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+
+namespace Rivet {
+
+/// All monitors of this process, the stop decision needs every one of them
+static std::vector<ConvergenceMonitor*> gMonitors;
+static pthread_mutex_t gMonitorsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+ConvergenceMonitor::ConvergenceMonitor()
+    : _enabled(false), _target(0.02), _minFraction(0.05), _checkEvery(500),
+      _events(0), _precision(1.), _converged(false) {}
+
+ConvergenceMonitor::~ConvergenceMonitor() {
+    if (!_enabled) return;
+    pthread_mutex_lock(&gMonitorsMutex);
+    gMonitors.erase(std::remove(gMonitors.begin(), gMonitors.end(), this), gMonitors.end());
+    pthread_mutex_unlock(&gMonitorsMutex);
+}
+
+bool ConvergenceMonitor::configure(const std::string& analysisName) {
+    _names = OptionList("CONVERGENCE_HISTOS");
+    if (_names.empty()) return false;
+    _analysis = analysisName;
+    _target = OptionDouble("CONVERGENCE_PRECISION", 0.02);
+    _minFraction = OptionDouble("CONVERGENCE_MINFRACTION", 0.05);
+    _checkEvery = OptionInt("CONVERGENCE_CHECK", 500);
+    if (_checkEvery == 0) _checkEvery = 1;
+    _enabled = true;
+    return true;
+}
+
+void ConvergenceMonitor::addHistogram(const std::string& name, AIDA::IHistogram1D* histo) {
+    if (std::find(_names.begin(), _names.end(), name) == _names.end()) return;
+    _histos.push_back(std::make_pair(name, histo));
+}
+
+void ConvergenceMonitor::start() {
+    if (!_enabled) return;
+    //only now, other threads may look at _histos from here on
+    pthread_mutex_lock(&gMonitorsMutex);
+    if (std::find(gMonitors.begin(), gMonitors.end(), this) == gMonitors.end())
+        gMonitors.push_back(this);
+    pthread_mutex_unlock(&gMonitorsMutex);
+}
+
+bool ConvergenceMonitor::converged() const {
+    pthread_mutex_lock(&gMonitorsMutex);
+    const bool converged = _converged;
+    pthread_mutex_unlock(&gMonitorsMutex);
+    return converged;
+}
+
+/// Largest relative bin error among the bins which matter for the shape
+double ConvergenceMonitor::relativeError(const AIDA::IHistogram1D* histo) const {
+    const int nBins = histo->axis().bins();
+    double maxHeight = 0.;
+    for (int i = 0; i < nBins; i++) maxHeight = std::max(maxHeight, histo->binHeight(i));
+    if (maxHeight <= 0.) return 1.;
+    double worst = 0.;
+    for (int i = 0; i < nBins; i++) {
+        const double height = histo->binHeight(i);
+        if (height < _minFraction*maxHeight) continue;
+        worst = std::max(worst, histo->binError(i)/height);
+    }
+    return worst;
+}
+
+void ConvergenceMonitor::update() {
+    if (!_enabled || !watching()) return;
+    if (++_events % _checkEvery != 0 || converged()) return;
+    _precision = 0.;
+    for (unsigned int i = 0; i < _histos.size(); i++)
+        _precision = std::max(_precision, relativeError(_histos[i].second));
+    if (_precision > _target) return;
+    pthread_mutex_lock(&gMonitorsMutex);
+    _converged = true;
+    pthread_mutex_unlock(&gMonitorsMutex);
+    std::cout << _analysis << ": watched histograms reached " << _precision
+              << " relative precision after " << _events << " events" << std::endl;
+    if (!allConverged()) return;
+    const std::string stopFile = OptionString("CONVERGENCE_STOPFILE");
+    if (stopFile.empty()) return;
+    std::ofstream stop(stopFile.c_str());
+    stop << _events << std::endl;
+    std::cout << "All watched histograms converged, requesting stop via " << stopFile << std::endl;
+}
+
+bool ConvergenceMonitor::allConverged() {
+    bool any = false, all = true;
+    pthread_mutex_lock(&gMonitorsMutex);
+    for (unsigned int i = 0; i < gMonitors.size(); i++) {
+        if (!gMonitors[i]->watching()) continue;
+        any = true;
+        all = all && gMonitors[i]->_converged;
+    }
+    pthread_mutex_unlock(&gMonitorsMutex);
+    return any && all;
+}
+
+}
@@ -0,0 +1,474 @@
+#include "EventStore.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "HepMC/GenEvent.h"
+#include "HepMC/GenParticle.h"
+#include "HepMC/GenVertex.h"
+#include "HepMC/IO_GenEvent.h"
+
+namespace EventStore {
+
+static const char kMagic[8] = {'J','C','E','V','0','0','0','1'};
+static const uint32_t kVersion = 2;
+static const uint32_t kByteOrder = 0x01020304;
+static const int kBeamStatus = 4;
+
+bool Keep(int pdgId, int status) {
+    //final state, plus quarks and gluons for the truth matching
+    return status == 1 || pdgId == 21 || (std::abs(pdgId) >= 1 && std::abs(pdgId) <= 6);
+}
+
+/// Append a column to a raw block
+template <typename T>
+static void appendColumn(std::vector<char>& raw, const std::vector<T>& column) {
+    if (column.empty()) return;
+    const char* data = reinterpret_cast<const char*>(&column[0]);
+    raw.insert(raw.end(), data, data + column.size()*sizeof(T));
+}
+
+template <typename T>
+static void appendAs(std::vector<char>& raw, const std::vector<double>& column) {
+    std::vector<T> converted(column.begin(), column.end());
+    appendColumn(raw, converted);
+}
+
+Writer::Writer(unsigned int eventsPerBlock, uint32_t flags, int level)
+    : _eventsPerBlock(eventsPerBlock ? eventsPerBlock : 1), _flags(flags), _level(level),
+      _file(0), _nEvents(0), _offset(0) {}
+
+Writer::~Writer() {
+    if (_file) close();
+}
+
+bool Writer::open(const std::string& fileName) {
+    _file = std::fopen(fileName.c_str(), "wb");
+    if (!_file) {
+        std::cerr << "Could not open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+    //the real header is written by close()
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::fwrite(&header, sizeof(header), 1, _file);
+    _offset = sizeof(header);
+    return !std::ferror(_file);
+}
+
+bool Writer::write(const HepMC::GenEvent& event) {
+    if (!_file) return false;
+    //weight names are taken from the first event, generators keep them fixed
+    if (_nEvents == 0 && !event.weights().empty()) {
+        _weightNames.assign(event.weights().size(), "");
+        for (HepMC::WeightContainer::const_map_iterator w = event.weights().map_begin(); w != event.weights().map_end(); ++w)
+            if (w->second < _weightNames.size()) _weightNames[w->second] = w->first;
+        bool named = false;
+        for (unsigned int i = 0; i < _weightNames.size(); i++) named = named || !_weightNames[i].empty();
+        if (!named) _weightNames.clear();
+    }
+    _eventNumber.push_back(event.event_number());
+    _processId.push_back(event.signal_process_id());
+    _nWeights.push_back(event.weights().size());
+    for (unsigned int i = 0; i < event.weights().size(); i++) _weights.push_back(event.weights()[i]);
+
+    const std::pair<HepMC::GenParticle*, HepMC::GenParticle*> beams = event.beam_particles();
+    unsigned int nParticles = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        //beams first, so they end up in front of the event
+        for (HepMC::GenEvent::particle_const_iterator p = event.particles_begin(); p != event.particles_end(); ++p) {
+            const bool beam = *p == beams.first || *p == beams.second;
+            if (pass == 0 ? !beam : (beam || !Keep((*p)->pdg_id(), (*p)->status()))) continue;
+            const HepMC::FourVector& mom = (*p)->momentum();
+            _px.push_back(mom.px());
+            _py.push_back(mom.py());
+            _pz.push_back(mom.pz());
+            _e.push_back(mom.e());
+            _pdgId.push_back((*p)->pdg_id());
+            _status.push_back(beam ? kBeamStatus : (*p)->status());
+            nParticles++;
+        }
+    }
+    _nParticles.push_back(nParticles);
+    _nEvents++;
+    if (_eventNumber.size() >= _eventsPerBlock) return flush();
+    return true;
+}
+
+bool Writer::flush() {
+    if (_eventNumber.empty()) return true;
+    std::vector<char> raw;
+    appendColumn(raw, _eventNumber);
+    appendColumn(raw, _processId);
+    appendColumn(raw, _nParticles);
+    appendColumn(raw, _nWeights);
+    appendColumn(raw, _weights);
+    if (_flags & kSinglePrecision) {
+        //the mass survives float precision, E^2 - p^2 of light particles does not
+        std::vector<double> mass(_e.size());
+        for (unsigned int i = 0; i < _e.size(); i++) {
+            const double m2 = _e[i]*_e[i] - _px[i]*_px[i] - _py[i]*_py[i] - _pz[i]*_pz[i];
+            mass[i] = m2 > 0. ? std::sqrt(m2) : 0.;
+        }
+        appendAs<float>(raw, _px);
+        appendAs<float>(raw, _py);
+        appendAs<float>(raw, _pz);
+        appendAs<float>(raw, mass);
+    } else {
+        appendColumn(raw, _px);
+        appendColumn(raw, _py);
+        appendColumn(raw, _pz);
+        appendColumn(raw, _e);
+    }
+    appendColumn(raw, _pdgId);
+    appendColumn(raw, _status);
+
+    uLongf compressedSize = compressBound(raw.size());
+    std::vector<Bytef> compressed(compressedSize);
+    if (compress2(&compressed[0], &compressedSize, reinterpret_cast<const Bytef*>(&raw[0]), raw.size(), _level) != Z_OK) {
+        std::cerr << "Could not compress event block" << std::endl;
+        return false;
+    }
+    BlockEntry entry;
+    entry.offset = _offset;
+    entry.compressedSize = compressedSize;
+    entry.rawSize = raw.size();
+    entry.firstEvent = _nEvents - _eventNumber.size();
+    entry.nEvents = _eventNumber.size();
+    entry.nParticles = _px.size();
+    std::fwrite(&compressed[0], 1, compressedSize, _file);
+    _offset += compressedSize;
+    _index.push_back(entry);
+
+    _eventNumber.clear();
+    _processId.clear();
+    _nParticles.clear();
+    _nWeights.clear();
+    _weights.clear();
+    _px.clear();
+    _py.clear();
+    _pz.clear();
+    _e.clear();
+    _pdgId.clear();
+    _status.clear();
+    return !std::ferror(_file);
+}
+
+bool Writer::close() {
+    if (!_file) return false;
+    bool ok = flush();
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.flags = _flags;
+    header.byteOrder = kByteOrder;
+    header.reserved = 0;
+    header.nEvents = _nEvents;
+    header.nBlocks = _index.size();
+    header.namesOffset = _offset;
+    header.nNames = _weightNames.size();
+    for (unsigned int i = 0; i < _weightNames.size(); i++) {
+        std::fwrite(_weightNames[i].c_str(), 1, _weightNames[i].size() + 1, _file);
+        _offset += _weightNames[i].size() + 1;
+    }
+    //keep the index 8 byte aligned for the mapped reader
+    const char padding[8] = {0,0,0,0,0,0,0,0};
+    const uint64_t aligned = (_offset + 7) & ~uint64_t(7);
+    std::fwrite(padding, 1, aligned - _offset, _file);
+    header.indexOffset = aligned;
+    if (!_index.empty()) std::fwrite(&_index[0], sizeof(BlockEntry), _index.size(), _file);
+    header.fileSize = aligned + _index.size()*sizeof(BlockEntry);
+    std::rewind(_file);
+    std::fwrite(&header, sizeof(header), 1, _file);
+    ok = ok && !std::ferror(_file);
+    ok = std::fclose(_file) == 0 && ok;
+    _file = 0;
+    _index.clear();
+    return ok;
+}
+
+Reader::Reader()
+    : _base(0), _length(0), _header(0), _index(0), _block(-1),
+      _eventNumber(0), _processId(0), _weights(0), _px(0), _py(0), _pz(0), _e(0),
+      _pdgId(0), _status(0) {}
+
+Reader::~Reader() {
+    close();
+}
+
+bool Reader::open(const std::string& fileName) {
+    close();
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open " << fileName << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        std::cerr << fileName << " is too short to be an event file" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Could not map " << fileName << std::endl;
+        return false;
+    }
+    _base = static_cast<const char*>(mapped);
+    _length = st.st_size;
+    _header = reinterpret_cast<const FileHeader*>(_base);
+    //sanity check, an unclosed file has a zero header
+    if (std::memcmp(_header->magic, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << fileName << " is not a valid (or not a completely written) event file" << std::endl;
+        close();
+        return false;
+    }
+    if (_header->byteOrder != kByteOrder) {
+        std::cerr << fileName << " was written with another byte order or an older jcevconvert, "
+                  << "convert the HepMC file again on this machine" << std::endl;
+        close();
+        return false;
+    }
+    if (_header->version != kVersion || _header->fileSize != _length || !validate()) {
+        std::cerr << fileName << " is not a valid (or not a completely written) event file" << std::endl;
+        close();
+        return false;
+    }
+    //the blocks are read front to back
+    madvise(mapped, _length, MADV_SEQUENTIAL);
+    _index = reinterpret_cast<const BlockEntry*>(_base + _header->indexOffset);
+    const char* name = _base + _header->namesOffset;
+    for (uint64_t i = 0; i < _header->nNames; i++) {
+        _weightNames.push_back(name);
+        name += _weightNames.back().size() + 1;
+    }
+    return true;
+}
+
+/// Every offset and size in the header and the index lies within the
+/// mapping and the blocks cover the events in order, so a corrupt file is
+/// refused here rather than read out of bounds later. What only the
+/// decompressed block can tell is checked by loadBlock().
+bool Reader::validate() const {
+    const FileHeader& h = *_header;
+    const uint64_t length = _length;
+    if (h.indexOffset > length || h.indexOffset % 8 != 0 ||
+        h.nBlocks > (length - h.indexOffset)/sizeof(BlockEntry) ||
+        h.namesOffset < sizeof(FileHeader) || h.namesOffset > h.indexOffset)
+        return false;
+    //each name is terminated before the index
+    const char* name = _base + h.namesOffset;
+    const char* end = _base + h.indexOffset;
+    for (uint64_t i = 0; i < h.nNames; i++) {
+        const char* terminator = static_cast<const char*>(std::memchr(name, 0, end - name));
+        if (!terminator) return false;
+        name = terminator + 1;
+    }
+    const BlockEntry* index = reinterpret_cast<const BlockEntry*>(_base + h.indexOffset);
+    uint64_t nEvents = 0;
+    for (uint64_t b = 0; b < h.nBlocks; b++) {
+        const BlockEntry& entry = index[b];
+        if (entry.offset < sizeof(FileHeader) || entry.offset > h.namesOffset ||
+            entry.compressedSize > h.namesOffset - entry.offset)
+            return false;
+        if (entry.firstEvent != nEvents || entry.nEvents == 0) return false;
+        nEvents += entry.nEvents;
+        //zlib expands by at most about 1032:1, anything above is corrupt
+        //and would only make loadBlock allocate it
+        if (entry.rawSize/1032 > entry.compressedSize) return false;
+    }
+    return nEvents == h.nEvents;
+}
+
+void Reader::close() {
+    if (_base) munmap(const_cast<char*>(_base), _length);
+    _base = 0;
+    _length = 0;
+    _header = 0;
+    _index = 0;
+    _weightNames.clear();
+    _block = -1;
+}
+
+uint64_t Reader::size() const {
+    return _header ? _header->nEvents : 0;
+}
+
+/// Column of n T at offset, advancing offset
+template <typename T>
+static const T* column(const std::vector<char>& raw, size_t& offset, size_t n) {
+    const T* col = reinterpret_cast<const T*>(&raw[0] + offset);
+    offset += n*sizeof(T);
+    return col;
+}
+
+bool Reader::loadBlock(unsigned int block) {
+    const BlockEntry& entry = _index[block];
+    const unsigned int n = entry.nEvents, p = entry.nParticles;
+    //four per event columns at least, validate() made sure n > 0
+    if (entry.rawSize < 4*uint64_t(n)*sizeof(uint32_t)) {
+        std::cerr << "Corrupt event block " << block << std::endl;
+        _block = -1;
+        return false;
+    }
+    _raw.resize(entry.rawSize);
+    uLongf rawSize = entry.rawSize;
+    if (uncompress(reinterpret_cast<Bytef*>(&_raw[0]), &rawSize,
+                   reinterpret_cast<const Bytef*>(_base + entry.offset), entry.compressedSize) != Z_OK ||
+        rawSize != entry.rawSize) {
+        std::cerr << "Corrupt event block " << block << std::endl;
+        _block = -1;
+        return false;
+    }
+    //the columns must fill the block exactly, checked before they are used
+    const uint64_t particleSize = ((_header->flags & kSinglePrecision) ? 4*sizeof(float) : 4*sizeof(double)) +
+        sizeof(int32_t) + sizeof(int16_t);
+    size_t offset = 0;
+    _eventNumber = column<int32_t>(_raw, offset, n);
+    _processId = column<int32_t>(_raw, offset, n);
+    const uint32_t* nParticles = column<uint32_t>(_raw, offset, n);
+    const uint32_t* nWeights = column<uint32_t>(_raw, offset, n);
+    uint64_t sumParticles = 0, sumWeights = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        sumParticles += nParticles[i];
+        sumWeights += nWeights[i];
+    }
+    if (sumParticles != p || entry.rawSize != offset + sumWeights*sizeof(double) + p*particleSize) {
+        std::cerr << "Corrupt event block " << block << std::endl;
+        _block = -1;
+        return false;
+    }
+    _first.resize(n + 1);
+    _firstWeight.resize(n + 1);
+    _first[0] = _firstWeight[0] = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        _first[i+1] = _first[i] + nParticles[i];
+        _firstWeight[i+1] = _firstWeight[i] + nWeights[i];
+    }
+    _weights = column<double>(_raw, offset, _firstWeight[n]);
+    if (_header->flags & kSinglePrecision) {
+        const float* px = column<float>(_raw, offset, p);
+        const float* py = column<float>(_raw, offset, p);
+        const float* pz = column<float>(_raw, offset, p);
+        const float* m = column<float>(_raw, offset, p);
+        _unpacked.resize(4*p);
+        for (unsigned int i = 0; i < p; i++) {
+            _unpacked[i] = px[i];
+            _unpacked[p + i] = py[i];
+            _unpacked[2*p + i] = pz[i];
+            _unpacked[3*p + i] = std::sqrt(double(px[i])*px[i] + double(py[i])*py[i] +
+                                           double(pz[i])*pz[i] + double(m[i])*m[i]);
+        }
+        const double* unpacked = p ? &_unpacked[0] : 0;
+        _px = unpacked;
+        _py = unpacked + p;
+        _pz = unpacked + 2*p;
+        _e = unpacked + 3*p;
+    } else {
+        _px = column<double>(_raw, offset, p);
+        _py = column<double>(_raw, offset, p);
+        _pz = column<double>(_raw, offset, p);
+        _e = column<double>(_raw, offset, p);
+    }
+    _pdgId = column<int32_t>(_raw, offset, p);
+    _status = column<int16_t>(_raw, offset, p);
+    _block = block;
+    return true;
+}
+
+bool Reader::event(uint64_t i, EventView& view) {
+    if (!_header || i >= _header->nEvents) return false;
+    //find the block, usually the current or the next one
+    unsigned int block = _block >= 0 ? _block : 0;
+    if (i < _index[block].firstEvent || i >= _index[block].firstEvent + _index[block].nEvents) {
+        unsigned int lo = 0, hi = _header->nBlocks;
+        while (hi - lo > 1) {
+            const unsigned int mid = lo + (hi - lo)/2;
+            if (_index[mid].firstEvent <= i) lo = mid;
+            else hi = mid;
+        }
+        block = lo;
+    }
+    if (static_cast<int>(block) != _block && !loadBlock(block)) return false;
+    const unsigned int k = i - _index[block].firstEvent;
+    const unsigned int first = _first[k];
+    view.eventNumber = _eventNumber[k];
+    view.processId = _processId[k];
+    view.nParticles = _first[k+1] - first;
+    view.px = _px + first;
+    view.py = _py + first;
+    view.pz = _pz + first;
+    view.e = _e + first;
+    view.pdgId = _pdgId + first;
+    view.status = _status + first;
+    view.nWeights = _firstWeight[k+1] - _firstWeight[k];
+    view.weights = _weights + _firstWeight[k];
+    return true;
+}
+
+HepMC::GenEvent* Reader::genEvent(uint64_t i) {
+    EventView view;
+    if (!event(i, view)) return 0;
+    HepMC::GenEvent* event = new HepMC::GenEvent(HepMC::Units::GEV, HepMC::Units::MM);
+    event->set_event_number(view.eventNumber);
+    event->set_signal_process_id(view.processId);
+    for (unsigned int w = 0; w < view.nWeights; w++) {
+        if (w < _weightNames.size() && !_weightNames[w].empty()) event->weights()[_weightNames[w]] = view.weights[w];
+        else event->weights().push_back(view.weights[w]);
+    }
+    HepMC::GenVertex* vertex = new HepMC::GenVertex();
+    event->add_vertex(vertex);
+    HepMC::GenParticle* beams[2] = {0, 0};
+    for (unsigned int j = 0; j < view.nParticles; j++) {
+        HepMC::GenParticle* particle = new HepMC::GenParticle(HepMC::FourVector(view.px[j], view.py[j], view.pz[j], view.e[j]),
+                                                              view.pdgId[j], view.status[j]);
+        if (view.status[j] == kBeamStatus) {
+            vertex->add_particle_in(particle);
+            if (!beams[0]) beams[0] = particle;
+            else if (!beams[1]) beams[1] = particle;
+        } else {
+            vertex->add_particle_out(particle);
+        }
+    }
+    if (beams[1]) event->set_beam_particles(beams[0], beams[1]);
+    return event;
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool Convert(const std::string& in, const std::string& out, uint32_t flags) {
+    if (endsWith(in, ".jcev")) {
+        Reader reader;
+        if (!reader.open(in)) return false;
+        HepMC::IO_GenEvent ascii(out, std::ios::out);
+        for (uint64_t i = 0; i < reader.size(); i++) {
+            HepMC::GenEvent* event = reader.genEvent(i);
+            if (!event) return false;
+            ascii << event;
+            delete event;
+        }
+        return true;
+    }
+    HepMC::IO_GenEvent ascii(in, std::ios::in);
+    Writer writer(256, flags);
+    if (!writer.open(out)) return false;
+    HepMC::GenEvent* event = 0;
+    while ((event = ascii.read_next_event())) {
+        writer.write(*event);
+        delete event;
+    }
+    return writer.close();
+}
+
+}
@@ -0,0 +1,309 @@
+#include "HistoStore.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace HistoStore {
+
+static const char kMagic[8] = {'H','B','I','N','0','0','0','1'};
+static const uint32_t kVersion = 2;
+static const uint32_t kByteOrder = 0x01020304;
+
+/// Value of attribute `key` in the tag text, empty if missing
+static std::string tagAttribute(const std::string& tag, const std::string& key) {
+    const std::string pattern = " " + key + "=\"";
+    size_t start = tag.find(pattern);
+    if (start == std::string::npos) {
+        //attributes may also follow a line break
+        start = tag.find("\n" + key + "=\"");
+        if (start == std::string::npos) return "";
+    }
+    start += pattern.size();
+    const size_t end = tag.find('"', start);
+    if (end == std::string::npos) return "";
+    return tag.substr(start, end - start);
+}
+
+/// Position of the '>' closing the tag opened at pos, npos if there is none.
+/// A '>' inside a quoted attribute value (e.g. title="p_T > 350") is text.
+static size_t tagEnd(const std::string& text, size_t pos) {
+    char quote = 0;
+    for (size_t i = pos + 1; i < text.size(); i++) {
+        const char c = text[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+static bool pathLess(const Histogram& a, const Histogram& b) {
+    return a.path < b.path;
+}
+
+bool ReadAIDA(const std::string& fileName, std::vector<Histogram>& histos) {
+    std::ifstream in(fileName.c_str());
+    if (!in) {
+        std::cerr << "Could not open " << fileName << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    Histogram* current = 0;
+    StoredBin bin;
+    unsigned int nMeasurements = 0;
+    size_t pos = 0;
+    while ((pos = text.find('<', pos)) != std::string::npos) {
+        const size_t end = tagEnd(text, pos);
+        if (end == std::string::npos) break;
+        const std::string tag = text.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+        if (tag.compare(0, 12, "dataPointSet") == 0) {
+            Histogram h;
+            h.path = tagAttribute(tag, "path") + "/" + tagAttribute(tag, "name");
+            h.title = tagAttribute(tag, "title");
+            histos.push_back(h);
+            current = &histos.back();
+        } else if (tag == "/dataPointSet") {
+            current = 0;
+        } else if (current && tag == "dataPoint") {
+            std::memset(&bin, 0, sizeof(bin));
+            nMeasurements = 0;
+        } else if (current && tag == "/dataPoint") {
+            current->bins.push_back(bin);
+        } else if (current && tag.compare(0, 11, "measurement") == 0) {
+            const double value = std::atof(tagAttribute(tag, "value").c_str());
+            const double errPlus = std::atof(tagAttribute(tag, "errorPlus").c_str());
+            const double errMinus = std::atof(tagAttribute(tag, "errorMinus").c_str());
+            if (nMeasurements == 0) {
+                bin.x = value; bin.xErrPlus = errPlus; bin.xErrMinus = errMinus;
+            } else if (nMeasurements == 1) {
+                bin.y = value; bin.yErrPlus = errPlus; bin.yErrMinus = errMinus;
+            }
+            nMeasurements++;
+        }
+    }
+    return true;
+}
+
+bool WriteAIDA(const std::string& fileName, const std::vector<Histogram>& histos) {
+    std::FILE* out = std::fopen(fileName.c_str(), "w");
+    if (!out) {
+        std::cerr << "Could not open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+    std::fprintf(out, "<?xml version=\"1.0\" ?>\n");
+    std::fprintf(out, "<!DOCTYPE aida SYSTEM \"http://aida.freehep.org/schemas/3.3/aida.dtd\">\n");
+    std::fprintf(out, "<aida version=\"3.3\">\n");
+    std::fprintf(out, "  <implementation version=\"1.1\" package=\"Rivet\"/>\n");
+    for (unsigned int i = 0; i < histos.size(); i++) {
+        const Histogram& h = histos[i];
+        const size_t slash = h.path.rfind('/');
+        const std::string dir = h.path.substr(0, slash);
+        const std::string name = h.path.substr(slash + 1);
+        std::fprintf(out, "  <dataPointSet name=\"%s\" dimension=\"2\"\n", name.c_str());
+        std::fprintf(out, "      path=\"%s\" title=\"%s\">\n", dir.c_str(), h.title.c_str());
+        std::fprintf(out, "    <annotation>\n");
+        std::fprintf(out, "      <item key=\"Title\" value=\"%s\" sticky=\"true\"/>\n", h.title.c_str());
+        std::fprintf(out, "      <item key=\"AidaPath\" value=\"%s\" sticky=\"true\"/>\n", h.path.c_str());
+        std::fprintf(out, "    </annotation>\n");
+        for (unsigned int b = 0; b < h.bins.size(); b++) {
+            const StoredBin& bin = h.bins[b];
+            std::fprintf(out, "  <dataPoint>\n");
+            std::fprintf(out, "    <measurement value=\"%e\" errorPlus=\"%e\" errorMinus=\"%e\"/>\n",
+                         bin.x, bin.xErrPlus, bin.xErrMinus);
+            std::fprintf(out, "    <measurement value=\"%e\" errorPlus=\"%e\" errorMinus=\"%e\"/>\n",
+                         bin.y, bin.yErrPlus, bin.yErrMinus);
+            std::fprintf(out, "  </dataPoint>\n");
+        }
+        std::fprintf(out, "  </dataPointSet>\n");
+    }
+    std::fprintf(out, "</aida>\n");
+    return std::fclose(out) == 0;
+}
+
+bool Write(const std::string& fileName, const std::vector<Histogram>& unsorted) {
+    std::vector<Histogram> histos(unsorted);
+    std::sort(histos.begin(), histos.end(), pathLess);
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.nHistos = histos.size();
+    header.byteOrder = kByteOrder;
+    header.reserved = 0;
+    header.indexOffset = sizeof(FileHeader);
+    header.stringsOffset = header.indexOffset + histos.size()*sizeof(IndexEntry);
+
+    //lay out strings, then the 8 byte aligned bin arrays
+    std::string strings;
+    std::vector<IndexEntry> index(histos.size());
+    for (unsigned int i = 0; i < histos.size(); i++) {
+        index[i].pathOffset = header.stringsOffset + strings.size();
+        strings.append(histos[i].path.c_str(), histos[i].path.size() + 1);
+        index[i].titleOffset = header.stringsOffset + strings.size();
+        strings.append(histos[i].title.c_str(), histos[i].title.size() + 1);
+        index[i].nBins = histos[i].bins.size();
+        index[i].reserved = 0;
+    }
+    header.dataOffset = (header.stringsOffset + strings.size() + 7) & ~uint64_t(7);
+    uint64_t offset = header.dataOffset;
+    for (unsigned int i = 0; i < histos.size(); i++) {
+        index[i].dataOffset = offset;
+        offset += histos[i].bins.size()*sizeof(StoredBin);
+    }
+    header.fileSize = offset;
+
+    std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!out) {
+        std::cerr << "Could not open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!index.empty())
+        out.write(reinterpret_cast<const char*>(&index[0]), index.size()*sizeof(IndexEntry));
+    out.write(strings.data(), strings.size());
+    const char padding[8] = {0,0,0,0,0,0,0,0};
+    out.write(padding, header.dataOffset - header.stringsOffset - strings.size());
+    for (unsigned int i = 0; i < histos.size(); i++) {
+        if (histos[i].bins.empty()) continue;
+        out.write(reinterpret_cast<const char*>(&histos[i].bins[0]), histos[i].bins.size()*sizeof(StoredBin));
+    }
+    return out.good();
+}
+
+Reader::Reader() : _base(0), _length(0), _header(0), _index(0) {}
+
+Reader::~Reader() {
+    close();
+}
+
+bool Reader::open(const std::string& fileName) {
+    close();
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open " << fileName << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        std::cerr << fileName << " is too short to be a histogram store" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Could not map " << fileName << std::endl;
+        return false;
+    }
+    _base = static_cast<const char*>(mapped);
+    _length = st.st_size;
+    _header = reinterpret_cast<const FileHeader*>(_base);
+    //sanity check
+    if (std::memcmp(_header->magic, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << fileName << " is not a valid histogram store" << std::endl;
+        close();
+        return false;
+    }
+    if (_header->byteOrder != kByteOrder) {
+        std::cerr << fileName << " was written with another byte order or an older aida2hbin, "
+                  << "convert the AIDA file again on this machine" << std::endl;
+        close();
+        return false;
+    }
+    if (_header->version != kVersion || _header->fileSize != _length || !validate()) {
+        std::cerr << fileName << " is not a valid histogram store" << std::endl;
+        close();
+        return false;
+    }
+    _index = reinterpret_cast<const IndexEntry*>(_base + _header->indexOffset);
+    return true;
+}
+
+/// Every offset and size in the header and the index lies within the
+/// mapping, so a truncated or corrupt file is refused here rather than
+/// read out of bounds later. Sizes are compared by division, offsets
+/// straight from the file may be anything.
+bool Reader::validate() const {
+    const FileHeader& h = *_header;
+    const uint64_t length = _length;
+    if (h.indexOffset < sizeof(FileHeader) || h.indexOffset > length || h.indexOffset % 8 != 0 ||
+        h.nHistos > (length - h.indexOffset)/sizeof(IndexEntry))
+        return false;
+    if (h.stringsOffset < h.indexOffset + uint64_t(h.nHistos)*sizeof(IndexEntry) ||
+        h.dataOffset < h.stringsOffset || h.dataOffset > length || h.dataOffset % 8 != 0)
+        return false;
+    //strings are null terminated and followed by zero padding, so a zero
+    //last byte ends every string which starts in the table
+    if (h.dataOffset > h.stringsOffset && _base[h.dataOffset - 1] != 0) return false;
+    const IndexEntry* index = reinterpret_cast<const IndexEntry*>(_base + h.indexOffset);
+    for (uint32_t i = 0; i < h.nHistos; i++) {
+        const IndexEntry& entry = index[i];
+        if (entry.pathOffset < h.stringsOffset || entry.pathOffset >= h.dataOffset ||
+            entry.titleOffset < h.stringsOffset || entry.titleOffset >= h.dataOffset)
+            return false;
+        if (entry.dataOffset < h.dataOffset || entry.dataOffset > length || entry.dataOffset % 8 != 0 ||
+            entry.nBins > (length - entry.dataOffset)/sizeof(StoredBin))
+            return false;
+    }
+    return true;
+}
+
+void Reader::close() {
+    if (_base) munmap(const_cast<char*>(_base), _length);
+    _base = 0;
+    _length = 0;
+    _header = 0;
+    _index = 0;
+}
+
+unsigned int Reader::size() const {
+    return _header ? _header->nHistos : 0;
+}
+
+const char* Reader::path(unsigned int i) const {
+    return _base + _index[i].pathOffset;
+}
+
+void Reader::fillView(const IndexEntry& entry, HistoView& view) const {
+    view.path = _base + entry.pathOffset;
+    view.title = _base + entry.titleOffset;
+    view.nBins = entry.nBins;
+    view.bins = reinterpret_cast<const StoredBin*>(_base + entry.dataOffset);
+}
+
+bool Reader::find(const std::string& histPath, HistoView& view) const {
+    if (!_header) return false;
+    //binary search over the sorted index, only the paths are touched
+    unsigned int lo = 0, hi = _header->nHistos;
+    while (lo < hi) {
+        const unsigned int mid = lo + (hi - lo)/2;
+        const int cmp = std::strcmp(path(mid), histPath.c_str());
+        if (cmp == 0) {
+            fillView(_index[mid], view);
+            return true;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+}
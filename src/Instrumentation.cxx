@@ -0,0 +1,225 @@
+#include "Instrumentation.h"
+#include "AnalysisOptions.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+#include <time.h>
+
+namespace Rivet {
+namespace Instrumentation {
+
+//quarter octaves of nanoseconds; below 4 ns every nanosecond is a bin
+static const unsigned int kTimeBins = 4*64;
+//constituents in bins of 10, the last one is the overflow
+static const unsigned int kConstituentBins = 101;
+static const long kConstituentWidth = 10;
+
+namespace {
+
+struct Block {
+    Block() : calls(0), totalNs(0), maxNs(0), counted(0), constituents(0), count(0) {
+        for (unsigned int i = 0; i < kTimeBins; i++) time[i] = 0;
+        for (unsigned int i = 0; i < kConstituentBins; i++) constituentBins[i] = 0;
+    }
+    void merge(const Block& other) {
+        calls += other.calls;
+        totalNs += other.totalNs;
+        if (other.maxNs > maxNs) maxNs = other.maxNs;
+        counted += other.counted;
+        constituents += other.constituents;
+        count += other.count;
+        for (unsigned int i = 0; i < kTimeBins; i++) time[i] += other.time[i];
+        for (unsigned int i = 0; i < kConstituentBins; i++) constituentBins[i] += other.constituentBins[i];
+    }
+    uint64_t calls, totalNs, maxNs;
+    uint64_t time[kTimeBins];
+    //calls which gave a constituent count, and their sum
+    uint64_t counted, constituents;
+    uint64_t constituentBins[kConstituentBins];
+    long count;
+};
+
+typedef std::vector<Block> Table;
+
+/// Names of the ids and the tables of all threads. The tables are owned
+/// here rather than by their threads so that the report still sees them
+/// after a worker has exited.
+struct Registry {
+    Registry() { pthread_mutex_init(&mutex, 0); }
+    pthread_mutex_t mutex;
+    std::vector<std::pair<std::string, std::string> > names;
+    std::vector<Table*> tables;
+};
+
+}
+
+static Registry* gRegistry = 0;
+static pthread_key_t gTableKey;
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+
+static void createRegistry() {
+    gRegistry = new Registry();
+    pthread_key_create(&gTableKey, 0);
+}
+
+static Registry& registry() {
+    pthread_once(&gOnce, &createRegistry);
+    return *gRegistry;
+}
+
+static Table& localTable(unsigned int id) {
+    Registry& reg = registry();
+    Table* table = static_cast<Table*>(pthread_getspecific(gTableKey));
+    if (!table) {
+        table = new Table();
+        pthread_mutex_lock(&reg.mutex);
+        reg.tables.push_back(table);
+        pthread_mutex_unlock(&reg.mutex);
+        pthread_setspecific(gTableKey, table);
+    }
+    if (id >= table->size()) table->resize(id + 1);
+    return *table;
+}
+
+static unsigned int timeBin(uint64_t ns) {
+    if (ns < 4) return ns;
+    const unsigned int octave = 63 - __builtin_clzll(ns);
+    return 4*octave + ((ns >> (octave - 2)) & 3);
+}
+
+/// Geometric centre of a time bin
+static double binCentre(unsigned int bin) {
+    if (bin < 4) return bin;
+    const unsigned int octave = bin/4;
+    const double lower = std::ldexp(4. + bin%4, octave - 2);
+    const double upper = std::ldexp(5. + bin%4, octave - 2);
+    return std::sqrt(lower*upper);
+}
+
+static double quantile(const Block& block, double q) {
+    if (block.calls == 0) return 0.;
+    const double target = q*block.calls;
+    uint64_t sum = 0;
+    for (unsigned int i = 0; i < kTimeBins; i++) {
+        sum += block.time[i];
+        if (sum >= target && block.time[i] > 0) {
+            const double centre = binCentre(i);
+            return centre < block.maxNs ? centre : block.maxNs;
+        }
+    }
+    return block.maxNs;
+}
+
+uint64_t Now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec)*1000000000 + ts.tv_nsec;
+}
+
+unsigned int Register(const char* group, const char* name) {
+    Registry& reg = registry();
+    pthread_mutex_lock(&reg.mutex);
+    unsigned int id = 0;
+    while (id < reg.names.size() && !(reg.names[id].first == group && reg.names[id].second == name)) id++;
+    if (id == reg.names.size()) reg.names.push_back(std::make_pair(std::string(group), std::string(name)));
+    pthread_mutex_unlock(&reg.mutex);
+    return id;
+}
+
+void Record(unsigned int id, uint64_t ns, long constituents) {
+    Block& block = localTable(id)[id];
+    block.calls++;
+    block.totalNs += ns;
+    if (ns > block.maxNs) block.maxNs = ns;
+    block.time[timeBin(ns)]++;
+    if (constituents >= 0) {
+        block.counted++;
+        block.constituents += constituents;
+        const long bin = constituents/kConstituentWidth;
+        block.constituentBins[bin < long(kConstituentBins) - 1 ? bin : kConstituentBins - 1]++;
+    }
+}
+
+void Count(unsigned int id, long n) {
+    localTable(id)[id].count += n;
+}
+
+void Report(const std::string& group, const CutFlow& cutFlow) {
+    Registry& reg = registry();
+    pthread_mutex_lock(&reg.mutex);
+    std::vector<std::string> names;
+    std::vector<Block> blocks;
+    unsigned int threads = 0;
+    for (unsigned int id = 0; id < reg.names.size(); id++) {
+        if (reg.names[id].first != group) continue;
+        names.push_back(reg.names[id].second);
+        blocks.push_back(Block());
+    }
+    for (unsigned int t = 0; t < reg.tables.size(); t++) {
+        const Table& table = *reg.tables[t];
+        bool used = false;
+        for (unsigned int id = 0, n = 0; id < reg.names.size(); id++) {
+            if (reg.names[id].first != group) continue;
+            if (id < table.size() && (table[id].calls > 0 || table[id].count != 0)) {
+                blocks[n].merge(table[id]);
+                used = true;
+            }
+            n++;
+        }
+        if (used) threads++;
+    }
+    pthread_mutex_unlock(&reg.mutex);
+
+    const std::string prefix = OptionString("INSTRUMENT_DIR", ".") + "/" + group + ".instrument";
+    std::ofstream json((prefix + ".json").c_str());
+    std::ofstream csv((prefix + ".csv").c_str());
+    if (!json || !csv) {
+        std::cerr << "Cannot write the instrumentation report " << prefix << ".json/.csv" << std::endl;
+        return;
+    }
+    json << "{\n  \"analysis\": \"" << group << "\",\n  \"threads\": " << threads << ",\n";
+    json << "  \"cutflow\": [";
+    for (unsigned int i = 0; i < cutFlow.size(); i++)
+        json << (i ? ", " : "") << "{\"stage\": \"" << cutFlow[i].first << "\", \"events\": " << cutFlow[i].second << "}";
+    json << "],\n  \"counters\": {";
+    bool first = true;
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        if (blocks[i].calls > 0) continue;
+        json << (first ? "" : ", ") << "\"" << names[i] << "\": " << blocks[i].count;
+        first = false;
+    }
+    json << "},\n  \"blocks\": [";
+    csv << "block,calls,total_s,mean_ns,p50_ns,p90_ns,p99_ns,max_ns,mean_constituents\n";
+    first = true;
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        const Block& b = blocks[i];
+        if (b.calls == 0) continue;
+        const double mean = double(b.totalNs)/b.calls;
+        const double meanConstituents = b.counted ? double(b.constituents)/b.counted : 0.;
+        json << (first ? "\n" : ",\n") << "    {\"block\": \"" << names[i] << "\", \"calls\": " << b.calls
+             << ", \"total_s\": " << 1e-9*b.totalNs << ", \"mean_ns\": " << mean
+             << ", \"p50_ns\": " << quantile(b, 0.5) << ", \"p90_ns\": " << quantile(b, 0.9)
+             << ", \"p99_ns\": " << quantile(b, 0.99) << ", \"max_ns\": " << b.maxNs;
+        if (b.counted) {
+            //trailing empty bins are left out, the last bin is the overflow
+            unsigned int nBins = kConstituentBins;
+            while (nBins > 0 && b.constituentBins[nBins - 1] == 0) nBins--;
+            json << ", \"mean_constituents\": " << meanConstituents
+                 << ", \"constituents\": {\"bin_width\": " << kConstituentWidth << ", \"counts\": [";
+            for (unsigned int c = 0; c < nBins; c++) json << (c ? ", " : "") << b.constituentBins[c];
+            json << "]}";
+        }
+        json << "}";
+        first = false;
+        csv << names[i] << "," << b.calls << "," << 1e-9*b.totalNs << "," << mean << "," << quantile(b, 0.5)
+            << "," << quantile(b, 0.9) << "," << quantile(b, 0.99) << "," << b.maxNs << ","
+            << meanConstituents << "\n";
+    }
+    json << "\n  ]\n}\n";
+    std::cout << "Instrumentation report of " << group << " written to " << prefix << ".json" << std::endl;
+}
+
+}
+}
@@ -0,0 +1,450 @@
+#include "JetChargeObservables.h"
+#include "AnalysisOptions.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "Rivet/Tools/ParticleIdUtils.hh"
+
+namespace Rivet {
+
+JetChargeObservables::JetChargeObservables()
+    : _validatePtScan(false), _ptScanMaxDev(0.) {
+    for(unsigned int i=0; i < 5; i++) _nPassing[i]=0;
+}
+
+void JetChargeObservables::book(HistogramBackend& backend) {
+    _radii.configure("JETCHARGE");
+    _histograms["JetMult"]		= backend.bookMultiWeight("JetMult"		, 6, -0.5, 5.5);
+    //Jet Kinematics
+    _histograms["JetPt"]		= backend.bookMultiWeight("JetPt"		, 50, 33, 300);
+    _histograms["JetE"]			= backend.bookMultiWeight("JetE"		, 25, 20, 300);
+    _histograms["JetEta"]		= backend.bookMultiWeight("JetEta"		, 25, -2, 2);
+    _histograms["JetRapidity"]		= backend.bookMultiWeight("JetRapidity"		, 25, -2, 2);
+    //_histograms["JetPhi"]		= backend.bookMultiWeight("JetPhi"		, 25, 0, TWOPI);
+    _histograms["JetMass"]		= backend.bookMultiWeight("JetMass"		, 100, 0, 40);
+    //_histograms["Jet2Mass"]		= backend.bookMultiWeight("Jet2Mass"		, 100, 0, 100);
+    //_histograms["Jet3Mass"]		= backend.bookMultiWeight("Jet3Mass"		, 100, 0, 100);
+    _histograms["SubJetMult"]		= backend.bookMultiWeight("SubJetMult"		, 15, -0.5, 29.5);
+    _histograms["SubJet2Mass"]		= backend.bookMultiWeight("SubJet2Mass"		, 100, 0, 35);
+    _histograms["SubJet3Mass"]		= backend.bookMultiWeight("SubJet3Mass"		, 100, 0, 45);
+    _histograms["SubJetDeltaR"]		= backend.bookMultiWeight("SubJetDeltaR"	, 50, 0, 1.0);
+    _histograms["SubJetMass"]		= backend.bookMultiWeight("SubJetMass"		, 100, 0, 12);
+    _histograms["SubJetSumEt"]		= backend.bookMultiWeight("SubJetSumEt"		, 30, 0, 175);
+
+    //Jet Charge Histos
+    _histograms["WCharge"]		= backend.bookMultiWeight("WCharge"		, 3, -1.5, 1.5);
+
+    //Jet charge for every k, inclusive and by truth parton
+    bookChargeHistograms(backend);
+
+    _histograms["ChargeSignPurity"]	= backend.bookMultiWeight("ChargeSignPurity"	,50,33,300);
+    _histograms["QuarkJetEta"]		= backend.bookMultiWeight("QuarkJetEta"		, 25, -2, 2);
+    _histograms["GluonJetEta"]		= backend.bookMultiWeight("GluonJetEta"		, 25, -2, 2);
+    _histograms["QuarkJetPt"]		= backend.bookMultiWeight("QuarkJetPt"		,50,33,300);
+    _histograms["GluonJetPt"]		= backend.bookMultiWeight("GluonJetPt"		,50,33,300);
+
+    _histograms["JetPullTheta"]		= backend.bookMultiWeight("JetPullTheta"	,50,-PI,PI);
+    _histograms["JetPullMag"]		= backend.bookMultiWeight("JetPullMag"		,50,0,0.04);
+    _histograms["TruthDeltaR"]		= backend.bookMultiWeight("TruthDeltaR"		,50,0,0.7);
+    _histograms["TruthPdgID"]		= backend.bookMultiWeight("TruthPdgID"		,7,-0.5,6.5);
+    //Dipolarity
+    _histograms["Dipolarity"]		= backend.bookMultiWeight("Dipolarity"		,50,0.0,1.5);
+    //Leading jet at every radius of the R scan
+    for(unsigned int i=0; i < _radii.size(); i++) {
+        const string sfx = _radii.suffix(i);
+        _histograms["JetPt"+sfx]	= backend.bookMultiWeight("JetPt"+sfx		, 50, 33, 300);
+        _histograms["JetMass"+sfx]	= backend.bookMultiWeight("JetMass"+sfx		, 100, 0, 60);
+        _histograms["WJetChargeK3"+sfx]	= backend.bookMultiWeight("WJetChargeK3"+sfx	, 50, -3, 3);
+        _histograms["WJetChargeK5"+sfx]	= backend.bookMultiWeight("WJetChargeK5"+sfx	, 50, -3, 3);
+    }
+    //Pull, charge and dipolarity of the leading jet for every constituent pT threshold
+    _ptScan.configure("JETCHARGE");
+    _validatePtScan = OptionInt("PTMIN_SCAN_VALIDATE", 0) != 0;
+    _scanPullMag.clear();
+    _scanPullTheta.clear();
+    _scanDipolarity.clear();
+    _scanCharge.clear();
+    for(unsigned int k=0; k < _kappas.size(); k++) {
+        for(unsigned int i=0; i < _ptScan.size(); i++) {
+            const string name = _chargeNames[k]+_ptScan.suffix(i);
+            _histograms[name]		= backend.bookMultiWeight(name			, 50, -3, 3);
+            _scanCharge.push_back(&_histograms[name]);
+        }
+    }
+    for(unsigned int i=0; i < _ptScan.size(); i++) {
+        const string sfx = _ptScan.suffix(i);
+        _histograms["JetPullTheta"+sfx]	= backend.bookMultiWeight("JetPullTheta"+sfx	,50,-PI,PI);
+        _histograms["JetPullMag"+sfx]	= backend.bookMultiWeight("JetPullMag"+sfx	,50,0,0.04);
+        _histograms["Dipolarity"+sfx]	= backend.bookMultiWeight("Dipolarity"+sfx	,50,0.0,1.5);
+        _scanPullTheta.push_back(&_histograms["JetPullTheta"+sfx]);
+        _scanPullMag.push_back(&_histograms["JetPullMag"+sfx]);
+        _scanDipolarity.push_back(&_histograms["Dipolarity"+sfx]);
+    }
+    //Energy correlation function ratios
+    _ecfBeta = OptionDouble("ECF_BETA", 1.);
+    _ecfMaxN = OptionInt("ECF_MAXN", ECFDefaultMaxN);
+    _thinning.configure("JETCHARGE");
+    _precision.configure();
+    _histograms["ECF_C2"]		= backend.bookMultiWeight("ECF_C2"		, 50, 0, 0.6);
+    _histograms["ECF_D2"]		= backend.bookMultiWeight("ECF_D2"		, 50, 0, 5);
+    _histograms["ECF_C3"]		= backend.bookMultiWeight("ECF_C3"		, 50, 0, 0.6);
+
+    //N-subjettiness histos
+    _histograms["JetMassFilt"]		= backend.bookMultiWeight("JetMassFilt"		, 60, 0, 50);
+    _histograms["JetMassTrim"]		= backend.bookMultiWeight("JetMassTrim"		, 60, 0, 50);
+    _histograms["JetMassPrune"]		= backend.bookMultiWeight("JetMassPrune"	, 60, 0, 20);
+    _histograms["NSubJettiness"]	= backend.bookMultiWeight("NSubJettiness"	, 40, -0.005, 1.005);
+    _histograms["NSubJettiness1Iter"]	= backend.bookMultiWeight("NSubJettiness1Iter"	, 40, -0.005, 1.005);
+    _histograms["NSubJettiness2Iter"]	= backend.bookMultiWeight("NSubJettiness2Iter"	, 40, -0.005, 1.005);
+}
+
+void JetChargeObservables::booked(std::map<std::string, MultiWeightHisto1D*>& histos) {
+    for(BookedHistos::iterator it = _histograms.begin(); it != _histograms.end(); ++it)
+        histos[it->first] = &it->second;
+}
+
+bool JetChargeObservables::hasMuonCandidate(const ParticleVector& particles) {
+    foreach (const Particle& mu, particles) {
+        if(abs(mu.pdgId()) != MUON) continue;
+        if(fabs(mu.momentum().eta()) > 2.4+0.6) continue;
+        double pT = mu.momentum().pT();
+        if(pT <= 25*GeV) {
+            foreach (const Particle& p, particles) {
+                if(p.pdgId() == PHOTON && deltaR(mu.momentum(), p.momentum()) < 0.6)
+                    pT += p.momentum().pT();
+            }
+        }
+        if(pT > 25*GeV) return true;
+    }
+    return false;
+}
+
+void JetChargeObservables::analyzeRadii(const FastJets& camJets, int wCharge, const EventWeights& weight) {
+    JETSTUDY_TIME("MC_GENSTUDY_JETCHARGE", "radii");
+    for(unsigned int i=0; i < _radii.size(); i++) {
+        _radii.jets(camJets, i, 35.0*GeV, _radiusJets);
+        if(_radiusJets.empty()) continue;
+        const fastjet::PseudoJet& jet = _radiusJets.front();
+        const double R = _radii.radius(i);
+        if(jet.eta() <= -(2.5-R) || jet.eta() >= (2.5-R)) continue;
+        const string sfx = _radii.suffix(i);
+        _histograms["JetPt"+sfx].fill(jet.pt(),weight);
+        _histograms["JetMass"+sfx].fill(jet.m(),weight);
+        const double chargeK3 = wCharge*JetCharge(camJets,jet,0.3,1*GeV);
+        const double chargeK5 = wCharge*JetCharge(camJets,jet,0.5,1*GeV);
+        _histograms["WJetChargeK3"+sfx].fill(chargeK3,weight);
+        _histograms["WJetChargeK5"+sfx].fill(chargeK5,weight);
+        if(_precision.enabled()) {
+            _precision.compare("WJetChargeK3"+sfx, _histograms["WJetChargeK3"+sfx].binWidth(),
+                               chargeK3, wCharge*JetCharge<double>(camJets,jet,0.3,1*GeV));
+            _precision.compare("WJetChargeK5"+sfx, _histograms["WJetChargeK5"+sfx].binWidth(),
+                               chargeK5, wCharge*JetCharge<double>(camJets,jet,0.5,1*GeV));
+        }
+    }
+}
+
+void JetChargeObservables::fillNSubJettiness(const string& name, const PseudoJets& constituents,
+                                             const PseudoJets& axes, const EventWeights& weight) {
+    const double tau = TauValue(2, 1, constituents, axes);
+    _histograms[name].fill(tau, weight);
+    _moments.fill(name, tau, weight[0]);
+    if(_precision.enabled())
+        _precision.compare(name, _histograms[name].binWidth(), tau, TauValue<double>(2, 1, constituents, axes));
+}
+
+/// Book the jet charge histograms of every k and build the dispatch
+/// table: for each (k, W charge, parton) the histograms its jet charge
+/// goes to, so filling needs neither names nor branches per event.
+void JetChargeObservables::bookChargeHistograms(HistogramBackend& backend) {
+    const char* chargeClass[5] = {"QuarkNegTwoThirds", "QuarkNegOneThird", "", "QuarkOneThird", "QuarkTwoThirds"};
+    const char* flavour[6] = {"", "Down", "Up", "Strange", "Charm", "Bottom"};
+    const vector<string> kappas = OptionList("JETCHARGE_KAPPAS", "0.3,0.5");
+    _kappas.clear();
+    _chargeNames.clear();
+    _chargeMoments.clear();
+    _chargeDispatch.assign(kappas.size()*2*kPartonSlots, vector<MultiWeightHisto1D*>());
+    for(unsigned int n=0; n < kappas.size(); n++) {
+        const double k = atof(kappas[n].c_str());
+        //K3, K5 for multiples of 0.1, else hundredths as in K0p25
+        const int hundredths = static_cast<int>(k*100+0.5);
+        stringstream kStr;
+        if(hundredths%10 == 0) kStr<<"K"<<hundredths/10;
+        else kStr<<"K"<<hundredths/100<<"p"<<(hundredths%100 < 10 ? "0" : "")<<hundredths%100;
+        const string sfx = kStr.str();
+        if(find(_chargeNames.begin(), _chargeNames.end(), "WJetCharge"+sfx) != _chargeNames.end()) {
+            cerr<<"Jet charge k="<<kappas[n]<<" gives the histograms of an earlier k ("<<sfx<<"), skipping it"<<endl;
+            continue;
+        }
+        const unsigned int i = _kappas.size();
+        _kappas.push_back(k);
+        _chargeNames.push_back("WJetCharge"+sfx);
+        _histograms["WJetCharge"+sfx]		= backend.bookMultiWeight("WJetCharge"+sfx	, 50, -3, 3);
+        _histograms["QuarkJetCharge"+sfx]	= backend.bookMultiWeight("QuarkJetCharge"+sfx	, 50, -3, 3);
+        _histograms["GluonJetCharge"+sfx]	= backend.bookMultiWeight("GluonJetCharge"+sfx	, 50, -3, 3);
+        for(unsigned int c=0; c < 5; c++) {
+            if(*chargeClass[c] == 0) continue;
+            _histograms[chargeClass[c]+sfx]	= backend.bookMultiWeight(chargeClass[c]+sfx	, 50, -3, 3);
+        }
+        for(unsigned int q=1; q < 6; q++)
+            _histograms[flavour[q]+("JetCharge"+sfx)]	= backend.bookMultiWeight(flavour[q]+("JetCharge"+sfx), 50, -3, 3);
+        _chargeMoments.push_back(&_moments["WJetCharge"+sfx]);
+
+        for(int w=0; w < 2; w++) {
+            const int wCharge = 2*w - 1;
+            //the last slot, for any other parton, has pdgId kMaxPdgId+1
+            for(int slot=0; slot < kPartonSlots; slot++) {
+                const int pdgId = slot - kMaxPdgId;
+                vector<MultiWeightHisto1D*>& targets = _chargeDispatch[chargeIndex(i, wCharge, pdgId)];
+                targets.push_back(&_histograms["WJetCharge"+sfx]);
+                if(pdgId != 0 && abs(pdgId) < 7) {
+                    targets.push_back(&_histograms["QuarkJetCharge"+sfx]);
+                    targets.push_back(&_histograms[chargeClass[wCharge*PID::threeCharge(pdgId) + 2]+sfx]);
+                    if(abs(pdgId) < 6) targets.push_back(&_histograms[flavour[abs(pdgId)]+("JetCharge"+sfx)]);
+                }
+                else if(pdgId == 21) {
+                    targets.push_back(&_histograms["GluonJetCharge"+sfx]);
+                }
+            }
+        }
+    }
+    _chargeDispatch.resize(_kappas.size()*2*kPartonSlots);
+}
+
+void JetChargeObservables::fillChargeHistograms(const fastjet::PseudoJet& jet, const FastJets& jetProjection,
+                                                const unsigned int kIndex, const int wCharge,
+                                                const EventWeights& weight, const int pdgId) {
+    JETSTUDY_TIME("MC_GENSTUDY_JETCHARGE", "jet charge");
+    const double k = _kappas[kIndex];
+    const double jetCharge = wCharge*JetCharge(jetProjection,jet,k,1*GeV);
+    const vector<MultiWeightHisto1D*>& targets = _chargeDispatch[chargeIndex(kIndex, wCharge, pdgId)];
+    for(unsigned int i=0; i < targets.size(); i++) targets[i]->fill(jetCharge,weight);
+    _chargeMoments[kIndex]->fill(jetCharge,weight[0]);
+    if(_precision.enabled())
+        _precision.compare(_chargeNames[kIndex], targets[0]->binWidth(),
+                           jetCharge, wCharge*JetCharge<double>(jetProjection,jet,k,1*GeV));
+}
+
+void JetChargeObservables::analyzePtScan(const FastJets& jetProjection, const fastjet::PseudoJet& jet,
+                                         const int wCharge, const EventWeights& weight) {
+    JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "pT threshold scan", jet.constituents().size());
+    _ptScan.compute(jetProjection, jet, _kappas);
+    const unsigned int nT = _ptScan.size();
+    for(unsigned int i=0; i < nT; i++) {
+        const std::pair<double,double>& pull = _ptScan.pull(i);
+        _scanPullMag[i]->fill(pull.first,weight);
+        if(pull.first > 0) _scanPullTheta[i]->fill(pull.second,weight);
+        _scanDipolarity[i]->fill(_ptScan.dipolarity(i),weight);
+        for(unsigned int k=0; k < _kappas.size(); k++)
+            _scanCharge[k*nT + i]->fill(wCharge*_ptScan.charge(k, i),weight);
+        if(!_validatePtScan) continue;
+        //against one call per threshold; the dipolarity has no threshold to compare with
+        const double ptmin = _ptScan.threshold(i);
+        const std::pair<double,double> ref = JetPull(jetProjection, jet, ptmin);
+        _ptScanMaxDev = max(_ptScanMaxDev, fabs(pull.first - ref.first));
+        if(pull.first > 0 && ref.first > 0) _ptScanMaxDev = max(_ptScanMaxDev, fabs(pull.second - ref.second));
+        for(unsigned int k=0; k < _kappas.size(); k++)
+            _ptScanMaxDev = max(_ptScanMaxDev, fabs(_ptScan.charge(k, i) - JetCharge(jetProjection, jet, _kappas[k], ptmin)));
+    }
+}
+
+void JetChargeObservables::analyzeSubJets(const fastjet::PseudoJet& jet, const EventWeights& weight) {
+    const PseudoJets constituents = jet.validated_cs()->constituents(jet);
+    JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "subjets", constituents.size());
+    const double ptmin=0.5*GeV;
+    double sumEt=0.0;
+    fastjet::ClusterSequence clusterSeq(constituents,fastjet::JetDefinition(fastjet::kt_algorithm,0.6));
+
+    PseudoJets subJets=clusterSeq.exclusive_jets_up_to(3);
+
+    fastjet::ClusterSequence antiKTClusterSeq(constituents,fastjet::JetDefinition(fastjet::antikt_algorithm,0.1));
+    PseudoJets smallSubJets=antiKTClusterSeq.inclusive_jets(ptmin);
+    int smallJetMult = smallSubJets.size();
+    _histograms["SubJetMult"].fill(smallJetMult,weight);
+    unsigned int nSubJets=subJets.size();
+
+    if(nSubJets==3)
+        _histograms["SubJet3Mass"].fill((subJets.at(0)+subJets.at(1)+subJets.at(2)).m(),weight);
+
+    for(unsigned int j=0;j!=nSubJets;++j) {
+        sumEt+=subJets.at(j).Et();
+        _histograms["SubJetMass"].fill(subJets.at(j).m());
+        for(unsigned int k=(j+1); k!=nSubJets;++k) {
+            _histograms["SubJetDeltaR"].fill(subJets.at(j).delta_R(subJets.at(k)),weight);
+            _histograms["SubJet2Mass"].fill((subJets.at(j)+subJets.at(k)).m(),weight);
+        }
+    }
+    _histograms["SubJetSumEt"].fill(sumEt,weight);
+}
+
+bool JetChargeObservables::analyzeJets(const FastJets& jetProjection, int wCharge, const ParticleVector& partons,
+                                       const EventWeights& weight) {
+    const PseudoJets& jets = jetProjection.pseudoJetsByPt(35.0*GeV);
+    if (jets.empty()) return false;
+    _nPassing[3]++;
+    const unsigned int jetMult=jets.size();
+    JETSTUDY_COUNT("MC_GENSTUDY_JETCHARGE", "jets", jetMult);
+    _histograms["JetMult"].fill(jetMult);
+    /// Rather than loop over all jets, just take the first hard
+    /// one, Make sure entire jet is within fiducial volume
+    if(jets.front().eta() <= -(2.5-0.6) || jets.front().eta() >= (2.5-0.6)) return true;
+    if(jets.front().has_valid_cs())
+        analyzeSubJets(jets.front(),weight);
+
+    foreach (const fastjet::PseudoJet& jet, jets) {
+        PseudoJets constituents = jet.constituents();
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "grooming", constituents.size());
+            const double filtMass = Filter(jetProjection.clusterSeq(),jet, FastJets::CAM, 3, 0.3).m();
+            const double trimMass = Trimmer(jetProjection.clusterSeq(),jet, FastJets::CAM, 0.03, 0.3).m();
+            const double pruneMass = Pruner(jetProjection.clusterSeq(),jet, FastJets::CAM, 0.4, 0.1).m();
+            _histograms["JetMassFilt"].fill(filtMass, weight);
+            _histograms["JetMassTrim"].fill(trimMass, weight);
+            _histograms["JetMassPrune"].fill(pruneMass, weight);
+            _moments.fill("JetMassFilt", filtMass, weight[0]);
+            _moments.fill("JetMassTrim", trimMass, weight[0]);
+            _moments.fill("JetMassPrune", pruneMass, weight[0]);
+        }
+        if (constituents.size() > 10) {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "n-subjettiness", constituents.size());
+            PseudoJets axes(GetAxes(jetProjection.clusterSeq(), 2, constituents, FastJets::CAM, 0.5));
+            fillNSubJettiness("NSubJettiness", constituents, axes, weight);
+            UpdateAxes(2, constituents, axes);
+            fillNSubJettiness("NSubJettiness1Iter", constituents, axes, weight);
+            UpdateAxes(2, constituents, axes);
+            fillNSubJettiness("NSubJettiness2Iter", constituents, axes, weight);
+        }
+    }
+    _nPassing[4]++;
+    //const double jetCharge=wCharge*JetCharge(jetProjection,jets.front(),0.5,1*GeV);
+    const PseudoJets leadConstituents = jets.front().constituents();
+    std::pair<double,double> tvec;
+    {
+        JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "pull and dipolarity", leadConstituents.size());
+        tvec=JetPull(jetProjection,jets.front());
+        _histograms["Dipolarity"].fill(Dipolarity(jets.front()),weight);
+    }
+    if(_ptScan.enabled()) analyzePtScan(jetProjection, jets.front(), wCharge, weight);
+    if(leadConstituents.size() > 2) {
+        JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "energy correlations", leadConstituents.size());
+        const JetPairCache pairs(_thinning.apply(leadConstituents));
+        const ECFResult ecf = EnergyCorrelations(pairs, _ecfBeta, _ecfMaxN);
+        if(_thinning.validating() && _thinning.thinned()) {
+            const JetPairCache fullPairs(leadConstituents);
+            const ECFResult fullEcf = EnergyCorrelations(fullPairs, _ecfBeta, _ecfMaxN);
+            _thinning.compare("C2", ecf.C2, fullEcf.C2);
+            _thinning.compare("D2", ecf.D2, fullEcf.D2);
+            _thinning.compare("C3", ecf.C3, fullEcf.C3);
+        }
+        _histograms["ECF_C2"].fill(ecf.C2, weight);
+        _histograms["ECF_D2"].fill(ecf.D2, weight);
+        _histograms["ECF_C3"].fill(ecf.C3, weight);
+        if(_ecfMaxN) {
+            _moments.fill("ECF_e2", ecf.e2, weight[0]);
+            _moments.fill("ECF_e2Error", ecf.e2Error, weight[0]);
+            _moments.fill("ECF_e3", ecf.e3, weight[0]);
+            _moments.fill("ECF_e3Error", ecf.e3Error, weight[0]);
+            _moments.fill("ECF_e4", ecf.e4, weight[0]);
+            _moments.fill("ECF_e4Error", ecf.e4Error, weight[0]);
+        }
+    }
+    _histograms["JetMass"].fill(jets.front().m(),weight);
+    _histograms["JetPt"].fill(jets.front().pt(),weight);
+    _histograms["JetE"].fill(jets.front().E(),weight);
+    _histograms["JetEta"].fill(jets.front().eta(),weight);
+    _histograms["JetRapidity"].fill(jets.front().rapidity(),weight);
+    //histograms["JetPhi"].fill(jets.front().phi(),weight);
+    _histograms["WCharge"].fill(wCharge,weight);
+    _histograms["JetPullMag"].fill(tvec.first,weight);
+    _moments.fill("JetPullMag",tvec.first,weight[0]);
+    if(tvec.first > 0) {
+        _histograms["JetPullTheta"].fill(tvec.second,weight);
+        _moments.fill("JetPullTheta",tvec.second,weight[0]);
+    }
+    const Particle* truthParton=NULL;
+    double truthDelR(0);
+    {
+        JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "truth matching", partons.size());
+        foreach (const Particle& p, partons) {
+            //This may be slow, but its the path of minimal obfuscation
+            const double delR = jets.front().delta_R(fastjet::PseudoJet(p.momentum().px(),
+                                                                        p.momentum().py(),
+                                                                        p.momentum().pz(),
+                                                                        p.momentum().E()));
+            if(truthParton==NULL){
+                truthDelR = delR;
+                truthParton = &p;
+            }
+            else if(delR < 0.6 && truthParton->momentum().pT() < p.momentum().pT()){
+                truthDelR = delR;
+                truthParton = &p;
+            }
+        }
+        _histograms["TruthDeltaR"].fill(truthDelR,weight);
+        truthParton = NULL;
+        foreach (const Particle& p, partons) {
+            const double delR = jets.front().delta_R(fastjet::PseudoJet(p.momentum().px(),
+                                                                        p.momentum().py(),
+                                                                        p.momentum().pz(),
+                                                                        p.momentum().E()));
+            if(truthParton==NULL){
+                truthDelR = delR;
+                truthParton = &p;
+            }
+            else if(delR < 0.4 && truthParton->momentum().pT() < p.momentum().pT()){
+                truthDelR = delR;
+                truthParton = &p;
+            }
+        }
+    }
+    const int pdgId = truthParton->pdgId();
+    _histograms["TruthPdgID"].fill((abs(pdgId)==21) ? 0 :abs(pdgId), weight);
+    for(unsigned int i=0; i < _kappas.size(); i++)
+        fillChargeHistograms(jets.front(), jetProjection, i, wCharge, weight, pdgId);
+    if(abs(pdgId) < 7) {
+        _histograms["QuarkJetPt"].fill(jets.front().pt(),weight);
+        _histograms["QuarkJetEta"].fill(jets.front().eta(),weight);
+        if(wCharge*PID::charge(pdgId) < 0.0) {
+            _histograms["ChargeSignPurity"].fill(jets.front().pt(),weight);
+        }
+    }
+    else if(pdgId == 21){
+        _histograms["GluonJetPt"].fill(jets.front().pt(),weight);
+        _histograms["GluonJetEta"].fill(jets.front().eta(),weight);
+    }
+    return true;
+}
+
+void JetChargeObservables::printCutFlow(std::ostream& os, const double* stageTime) const {
+    // Time is spent by the events entering a stage, us/event is per
+    // event entering it
+    const char* stages[5] = {"Inclusive ", "Muon      ", "Found W   ", ">1 Jet    ", "Fiducial  "};
+    os<<"Cut summary: "<<endl;
+    os<<"| Inclusive | "<<_nPassing[0]<< " | stage time [s] | us/event |"<<endl;
+    for(unsigned int i=1; i < 5; i++) {
+        os<<"| "<<stages[i]<<"| "<<_nPassing[i]<< " | "<<stageTime[i-1]<<" | ";
+        os<<(_nPassing[i-1] > 0 ? 1e6*stageTime[i-1]/_nPassing[i-1] : 0.)<<" |"<<endl;
+    }
+}
+
+Instrumentation::CutFlow JetChargeObservables::cutFlow() const {
+    const char* stages[5] = {"Inclusive", "Muon", "Found W", ">1 Jet", "Fiducial"};
+    Instrumentation::CutFlow flow;
+    for(unsigned int i=0; i < 5; i++) flow.push_back(std::make_pair(std::string(stages[i]), long(_nPassing[i])));
+    return flow;
+}
+
+void JetChargeObservables::print(std::ostream& os, const std::string& name) {
+    _thinning.print(os, name);
+    _precision.print(os, name);
+    if(_validatePtScan)
+        os<<"Largest deviation of the pT threshold scan from single threshold calls: "<<_ptScanMaxDev<<endl;
+    //from the moments rather than the histograms, whose mean and rms
+    //only see the binned range
+    for(unsigned int i=0; i < _kappas.size(); i++)
+        os<<"Mean Jet Charge (k="<<_kappas[i]<<"): "<<_chargeMoments[i]->mean()<<" +/- "<<_chargeMoments[i]->rms()<<endl;
+    if(_ecfMaxN) PrintECFTruncation(os, _moments, _ecfMaxN);
+    _moments.print(os);
+}
+
+}
@@ -0,0 +1,118 @@
+#include "MultiWeightHisto.h"
+#include "AnalysisCheckpoint.h"
+#include "AnalysisOptions.h"
+#include "ConvergenceMonitor.h"
+
+#include <cctype>
+#include <iostream>
+
+#include "Rivet/Event.hh"
+#include "HepMC/GenEvent.h"
+
+namespace Rivet {
+
+WeightStreams::WeightStreams() : _suffixes(1, "") {}
+
+void WeightStreams::configure() {
+    _names = OptionList("WEIGHTS");
+    _indices.assign(_names.size(), -1);
+    _suffixes.assign(1, "");
+    _warned.assign(_names.size(), false);
+    for (unsigned int i = 0; i < _names.size(); i++) {
+        std::string suffix = "_";
+        bool numeric = true;
+        for (unsigned int c = 0; c < _names[i].size(); c++) {
+            const char ch = _names[i][c];
+            numeric = numeric && std::isdigit(ch);
+            //histogram names end up in paths, keep them plain
+            suffix += std::isalnum(ch) ? ch : '_';
+        }
+        if (numeric) {
+            _indices[i] = std::atoi(_names[i].c_str());
+            suffix = "_W" + _names[i];
+        }
+        _suffixes.push_back(suffix);
+    }
+}
+
+void WeightStreams::weights(const Event& event, EventWeights& w) const {
+    w.resize(size());
+    w[0] = event.weight();
+    const HepMC::WeightContainer& genWeights = event.genEvent().weights();
+    for (unsigned int i = 0; i < _names.size(); i++) {
+        bool found = false;
+        if (_indices[i] >= 0) {
+            found = static_cast<size_t>(_indices[i]) < genWeights.size();
+            if (found) w[i+1] = genWeights[_indices[i]];
+        } else {
+            found = genWeights.has_key(_names[i]);
+            if (found) w[i+1] = genWeights[_names[i]];
+        }
+        if (!found) missing(i, w);
+    }
+}
+
+void WeightStreams::weights(const double* values, size_t n, const std::vector<std::string>& names,
+                            EventWeights& w) const {
+    w.resize(size());
+    //as Event::weight()
+    w[0] = n > 0 ? values[0] : 1.;
+    for (unsigned int i = 0; i < _names.size(); i++) {
+        size_t index = n;
+        if (_indices[i] >= 0) {
+            index = _indices[i];
+        } else {
+            for (size_t j = 0; j < names.size() && j < n; j++)
+                if (names[j] == _names[i]) index = j;
+        }
+        if (index < n) w[i+1] = values[index];
+        else missing(i, w);
+    }
+}
+
+void WeightStreams::missing(size_t i, EventWeights& w) const {
+    //a missing weight must not look like a valid variation
+    w[i+1] = 0.;
+    if (!_warned[i]) {
+        std::cerr << "Event has no weight " << _names[i] << ", filling its histograms with zero" << std::endl;
+        _warned[i] = true;
+    }
+}
+
+MultiWeightHisto1D HistogramBackend::bookMultiWeight(const std::string& name, size_t nbins,
+                                                     double lower, double upper) {
+    MultiWeightHisto1D histo;
+    for (unsigned int i = 0; i < _streams.size(); i++)
+        histo.add(bookHistogram(name + _streams.suffix(i), nbins, lower, upper));
+    return histo;
+}
+
+void HistogramBackend::normalize(MultiWeightHisto1D& histo) {
+    for (unsigned int i = 0; i < histo.size(); i++) {
+        const double area = histo[i]->sumAllBinHeights();
+        if (area == 0.) {
+            std::cerr << "Histogram has null integral during normalization" << std::endl;
+            continue;
+        }
+        scale(histo[i], 1./area);
+    }
+}
+
+void HistogramBackend::registerHistograms(const std::map<std::string, MultiWeightHisto1D*>& histos,
+                                          AnalysisCheckpoint& checkpoint,
+                                          ConvergenceMonitor& convergence) const {
+    typedef std::map<std::string, MultiWeightHisto1D*>::const_iterator Iter;
+    if (checkpoint.enabled()) {
+        for (Iter h = histos.begin(); h != histos.end(); ++h)
+            for (unsigned int i = 0; i < h->second->size(); i++)
+                checkpoint.addHistogram(h->first + _streams.suffix(i), (*h->second)[i]);
+    }
+    //precision is judged on the nominal weights only
+    if (convergence.enabled()) {
+        for (Iter h = histos.begin(); h != histos.end(); ++h)
+            convergence.addHistogram(h->first, (*h->second)[0]);
+        convergence.start();
+    }
+}
+
+}
@@ -0,0 +1,138 @@
+#include "RunningMoments.h"
+#include "AnalysisOptions.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace Rivet {
+
+void RunningMoments::fill(double x, double w) {
+    _entries++;
+    _sumW2 += w*w;
+    if (w == 0.) return;
+    const double sumW = _sumW + w;
+    const double delta = x - _mean;
+    //with a sum of weights of exactly zero the mean is undefined, keep the old one
+    if (sumW != 0.) _mean += delta*w/sumW;
+    _m2 += w*delta*(x - _mean);
+    _sumW = sumW;
+}
+
+void RunningMoments::merge(const RunningMoments& other) {
+    _entries += other._entries;
+    _sumW2 += other._sumW2;
+    if (other._sumW == 0.) {
+        _m2 += other._m2;
+        return;
+    }
+    const double sumW = _sumW + other._sumW;
+    const double delta = other._mean - _mean;
+    if (sumW != 0.) {
+        _mean += delta*other._sumW/sumW;
+        _m2 += other._m2 + delta*delta*_sumW*other._sumW/sumW;
+    } else {
+        _m2 += other._m2;
+    }
+    _sumW = sumW;
+}
+
+double RunningMoments::variance() const {
+    if (_sumW == 0.) return 0.;
+    //rounding can leave a tiny negative m2 for constant values
+    return _m2 > 0. ? _m2/_sumW : 0.;
+}
+
+double RunningMoments::rms() const {
+    return std::sqrt(variance());
+}
+
+double RunningMoments::meanError() const {
+    if (_sumW == 0.) return 0.;
+    return rms()*std::sqrt(_sumW2)/std::fabs(_sumW);
+}
+
+void MomentSet::merge(const MomentSet& other) {
+    for (Map::const_iterator it = other._moments.begin(); it != other._moments.end(); ++it)
+        _moments[it->first].merge(it->second);
+}
+
+bool MomentSet::write(const std::string& fileName, const std::string& analysis) const {
+    std::ofstream out(fileName.c_str());
+    if (!out) {
+        std::cerr << "Cannot write the moments " << fileName << std::endl;
+        return false;
+    }
+    out.precision(17);
+    out << "{\n  \"analysis\": \"" << analysis << "\",\n  \"moments\": [";
+    for (Map::const_iterator it = _moments.begin(); it != _moments.end(); ++it) {
+        const RunningMoments& m = it->second;
+        //one quantity per line, read() relies on it
+        out << (it == _moments.begin() ? "\n" : ",\n") << "    {\"name\": \"" << it->first
+            << "\", \"entries\": " << m.entries() << ", \"sumw\": " << m.sumW()
+            << ", \"sumw2\": " << m.sumW2() << ", \"mean\": " << m.mean() << ", \"m2\": " << m.m2()
+            << ", \"rms\": " << m.rms() << ", \"mean_error\": " << m.meanError() << "}";
+    }
+    out << "\n  ]\n}\n";
+    return !out.fail();
+}
+
+/// Value of "key": in a line written by MomentSet::write, false if absent
+static bool field(const std::string& line, const std::string& key, double& value) {
+    const std::string tag = "\"" + key + "\": ";
+    const std::string::size_type pos = line.find(tag);
+    if (pos == std::string::npos) return false;
+    value = std::strtod(line.c_str() + pos + tag.size(), 0);
+    return true;
+}
+
+static bool field(const std::string& line, const std::string& key, std::string& value) {
+    const std::string tag = "\"" + key + "\": \"";
+    const std::string::size_type pos = line.find(tag);
+    if (pos == std::string::npos) return false;
+    const std::string::size_type end = line.find('"', pos + tag.size());
+    if (end == std::string::npos) return false;
+    value = line.substr(pos + tag.size(), end - pos - tag.size());
+    return true;
+}
+
+bool MomentSet::read(const std::string& fileName, std::string& analysis) {
+    std::ifstream in(fileName.c_str());
+    if (!in) {
+        std::cerr << "Cannot read the moments " << fileName << std::endl;
+        return false;
+    }
+    _moments.clear();
+    analysis.clear();
+    std::string line, name;
+    while (std::getline(in, line)) {
+        if (analysis.empty() && field(line, "analysis", analysis)) continue;
+        if (!field(line, "name", name)) continue;
+        double entries = 0., sumW = 0., sumW2 = 0., mean = 0., m2 = 0.;
+        if (!field(line, "entries", entries) || !field(line, "sumw", sumW) || !field(line, "sumw2", sumW2) ||
+            !field(line, "mean", mean) || !field(line, "m2", m2)) {
+            std::cerr << fileName << ": incomplete entry for " << name << std::endl;
+            return false;
+        }
+        _moments[name] = RunningMoments(static_cast<long>(entries), sumW, sumW2, mean, m2);
+    }
+    return true;
+}
+
+void MomentSet::report(const std::string& analysis) const {
+    const std::string fileName = OptionString("MOMENTS_DIR", ".") + "/" + analysis + ".moments.json";
+    if (write(fileName, analysis))
+        std::cout << "Moments of " << analysis << " written to " << fileName << std::endl;
+}
+
+void MomentSet::print(std::ostream& os) const {
+    for (Map::const_iterator it = _moments.begin(); it != _moments.end(); ++it) {
+        const RunningMoments& m = it->second;
+        os << std::setw(20) << std::left << it->first << std::right << " " << std::setw(9) << m.entries()
+           << "  mean " << m.mean() << " +/- " << m.meanError() << "  rms " << m.rms() << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,85 @@
+#include "ScratchArena.h"
+
+#include <cstdlib>
+#include <new>
+#include <pthread.h>
+
+namespace Rivet {
+
+//enough for any scalar, including long double
+static const size_t kAlignment = 16;
+
+ScratchArena::ScratchArena(size_t blockSize)
+    : _blockSize(blockSize), _current(0), _offset(0) {}
+
+ScratchArena::~ScratchArena() {
+    for (unsigned int i = 0; i < _blocks.size(); i++) std::free(_blocks[i]);
+}
+
+void* ScratchArena::allocate(size_t bytes) {
+    bytes = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+    //the current block, or the next one that fits
+    while (_current < _blocks.size()) {
+        if (_offset + bytes <= _sizes[_current]) {
+            void* p = _blocks[_current] + _offset;
+            _offset += bytes;
+            return p;
+        }
+        _current++;
+        _offset = 0;
+    }
+    const size_t size = bytes > _blockSize ? bytes : _blockSize;
+    char* block = static_cast<char*>(std::malloc(size));
+    if (!block) throw std::bad_alloc();
+    _blocks.push_back(block);
+    _sizes.push_back(size);
+    _current = _blocks.size() - 1;
+    _offset = bytes;
+    return block;
+}
+
+void ScratchArena::reset() {
+    //one block of the total size serves the next event of this size in one go
+    if (_blocks.size() > 1) {
+        const size_t total = capacity();
+        for (unsigned int i = 0; i < _blocks.size(); i++) std::free(_blocks[i]);
+        _blocks.clear();
+        _sizes.clear();
+        char* block = static_cast<char*>(std::malloc(total));
+        if (block) {
+            _blocks.push_back(block);
+            _sizes.push_back(total);
+        }
+    }
+    _current = 0;
+    _offset = 0;
+}
+
+size_t ScratchArena::capacity() const {
+    size_t total = 0;
+    for (unsigned int i = 0; i < _sizes.size(); i++) total += _sizes[i];
+    return total;
+}
+
+static pthread_key_t gArenaKey;
+static pthread_once_t gArenaOnce = PTHREAD_ONCE_INIT;
+
+static void deleteArena(void* arena) {
+    delete static_cast<ScratchArena*>(arena);
+}
+
+static void createArenaKey() {
+    pthread_key_create(&gArenaKey, &deleteArena);
+}
+
+ScratchArena& ScratchArena::local() {
+    pthread_once(&gArenaOnce, &createArenaKey);
+    ScratchArena* arena = static_cast<ScratchArena*>(pthread_getspecific(gArenaKey));
+    if (!arena) {
+        arena = new ScratchArena();
+        pthread_setspecific(gArenaKey, arena);
+    }
+    return *arena;
+}
+
+}
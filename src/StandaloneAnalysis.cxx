@@ -0,0 +1,152 @@
+#include "StandaloneAnalysis.h"
+#include "Rivet/Tools/ParticleIdUtils.hh"
+#include "LWH/Histogram1D.h"
+
+namespace Rivet {
+
+void ReadParticles(const EventStore::EventView& view, ParticleVector& finalState,
+                   ParticleVector& partons) {
+    finalState.clear();
+    partons.clear();
+    for (unsigned int i = 0; i < view.nParticles; i++) {
+        const int pdgId = view.pdgId[i];
+        const bool parton = pdgId == 21 || abs(pdgId) <= 6;
+        if (view.status[i] != 1 && !parton) continue;
+        const Particle p(pdgId, FourMomentum(view.e[i], view.px[i], view.py[i], view.pz[i]));
+        if (view.status[i] == 1) finalState.push_back(p);
+        if (parton) partons.push_back(p);
+    }
+}
+
+void SelectEta(const ParticleVector& particles, double maxEta, ParticleVector& selected) {
+    selected.clear();
+    foreach (const Particle& p, particles) {
+        const double eta = p.momentum().eta();
+        if (eta > -maxEta && eta < maxEta) selected.push_back(p);
+    }
+}
+
+/// As VisibleFinalState
+static bool isVisible(int pdgId) {
+    return PID::threeCharge(pdgId) != 0 || PID::isHadron(pdgId) || pdgId == PHOTON || pdgId == GLUON;
+}
+
+bool FindMuonW(const ParticleVector& finalState, Particle& boson, ParticleVector& remaining) {
+    //muons, each dressed with the photons closer to it than to any other muon
+    std::vector<size_t> muons;
+    for (size_t i = 0; i < finalState.size(); i++)
+        if (abs(finalState[i].pdgId()) == MUON) muons.push_back(i);
+    if (muons.empty()) return false;
+    std::vector<FourMomentum> dressed;
+    foreach (size_t m, muons) dressed.push_back(finalState[m].momentum());
+    double visibleEt = 0.;
+    foreach (const Particle& p, finalState) {
+        if (isVisible(p.pdgId())) visibleEt += p.momentum().Et();
+        if (p.pdgId() != PHOTON) continue;
+        int closest = -1;
+        double dRmin = 0.6;
+        for (size_t m = 0; m < muons.size(); m++) {
+            const double dR = deltaR(p.momentum(), finalState[muons[m]].momentum());
+            if (dR < dRmin) {
+                dRmin = dR;
+                closest = m;
+            }
+        }
+        if (closest >= 0) dressed[closest] += p.momentum();
+    }
+
+    //the muon neutrino pair with the transverse mass closest to the W mass
+    int bestMuon = -1, bestNeutrino = -1;
+    double bestDiff = 0.;
+    for (size_t m = 0; m < muons.size(); m++) {
+        const FourMomentum& mu = dressed[m];
+        if (mu.eta() <= -2.4 || mu.eta() >= 2.4 || mu.pT() <= 25*GeV) continue;
+        const int muId = finalState[muons[m]].pdgId();
+        const int nuId = muId > 0 ? -NU_MU : NU_MU;
+        for (size_t n = 0; n < finalState.size(); n++) {
+            if (finalState[n].pdgId() != nuId) continue;
+            const FourMomentum& nu = finalState[n].momentum();
+            const FourMomentum sum = mu + nu;
+            const double mT = sqrt(sqr(mu.Et() + nu.Et()) - sqr(sum.pT()));
+            if (!(mT > 40*GeV && mT < 1000*GeV)) continue;
+            const double diff = fabs(mT - 80.4*GeV);
+            if (bestMuon < 0 || diff < bestDiff) {
+                bestDiff = diff;
+                bestMuon = m;
+                bestNeutrino = n;
+            }
+        }
+    }
+    if (bestMuon < 0 || visibleEt < 25*GeV) return false;
+
+    const int muId = finalState[muons[bestMuon]].pdgId();
+    boson = Particle(muId > 0 ? WMINUSBOSON : WPLUSBOSON,
+                     dressed[bestMuon] + finalState[bestNeutrino].momentum());
+    remaining.clear();
+    for (size_t i = 0; i < finalState.size(); i++) {
+        if (i == muons[bestMuon] || i == static_cast<size_t>(bestNeutrino)) continue;
+        remaining.push_back(finalState[i]);
+    }
+    return true;
+}
+
+PileupOverlay::PileupOverlay() : _next(0) {}
+
+bool PileupOverlay::open(const std::string& fileName) {
+    if (!_reader.open(fileName)) return false;
+    if (_reader.size() == 0) {
+        std::cerr << "No events in " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PileupOverlay::overlay(unsigned int k, ParticleVector& finalState, ParticleVector& partons) {
+    for (unsigned int i = 0; i < k; i++) {
+        if (!_reader.event(_next, _view)) return false;
+        _next = (_next + 1) % _reader.size();
+        ReadParticles(_view, _finalState, _partons);
+        finalState.insert(finalState.end(), _finalState.begin(), _finalState.end());
+        partons.insert(partons.end(), _partons.begin(), _partons.end());
+    }
+    return true;
+}
+
+StandaloneHistograms::StandaloneHistograms(const std::string& path, const WeightStreams& streams)
+    : HistogramBackend(streams), _path(path) {}
+
+StandaloneHistograms::~StandaloneHistograms() {
+    for (size_t i = 0; i < _histos.size(); i++) delete _histos[i].second;
+}
+
+AIDA::IHistogram1D* StandaloneHistograms::bookHistogram(const std::string& name, size_t nbins,
+                                                        double lower, double upper) {
+    AIDA::IHistogram1D* h = new LWH::Histogram1D(nbins, lower, upper);
+    _histos.push_back(std::make_pair(name, h));
+    return h;
+}
+
+void StandaloneHistograms::scale(AIDA::IHistogram1D*& histo, double factor) {
+    histo->scale(factor);
+}
+
+void StandaloneHistograms::collect(std::vector<HistoStore::Histogram>& histos) const {
+    for (size_t i = 0; i < _histos.size(); i++) {
+        const AIDA::IHistogram1D& h = *_histos[i].second;
+        const AIDA::IAxis& axis = h.axis();
+        HistoStore::Histogram out;
+        out.path = _path + "/" + _histos[i].first;
+        for (int b = 0; b < axis.bins(); b++) {
+            const double width = axis.binWidth(b);
+            HistoStore::StoredBin bin;
+            bin.x = 0.5*(axis.binLowerEdge(b) + axis.binUpperEdge(b));
+            bin.xErrMinus = bin.xErrPlus = 0.5*width;
+            bin.y = h.binHeight(b)/width;
+            bin.yErrMinus = bin.yErrPlus = h.binError(b)/width;
+            out.bins.push_back(bin);
+        }
+        histos.push_back(out);
+    }
+}
+
+}
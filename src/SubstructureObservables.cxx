@@ -0,0 +1,786 @@
+#include "SubstructureObservables.h"
+#include "AnalysisOptions.h"
+#include "ScratchArena.h"
+#include "Instrumentation.h"
+#include <fastjet/ClusterSequence.hh>
+
+namespace Rivet {
+
+// Adapted code from Lily
+static FourMomentum RotateAxes(const Rivet::FourMomentum& p, double M[3][3]) {
+    double px_rot=M[0][0]*(p.px())+M[0][1]*(p.py())+M[0][2]*(p.pz());
+    double py_rot=M[1][0]*(p.px())+M[1][1]*(p.py())+M[1][2]*(p.pz());
+    double pz_rot=M[2][0]*(p.px())+M[2][1]*(p.py())+M[2][2]*(p.pz());
+    return FourMomentum(p.E(), px_rot, py_rot, pz_rot);
+}
+
+// Untouched code from Lily
+static void CalcRotationMatrix(double nvec[3],double rot_mat[3][3]) {
+    //clear momentum tensor
+    for(int i=0; i<3; i++) {
+        for(int j=0; j<3; j++) {
+            rot_mat[i][j]=0.;
+        }
+    }
+    double mag3=sqrt(nvec[0]*nvec[0] + nvec[1]*nvec[1]+ nvec[2]*nvec[2]);
+    double mag2=sqrt(nvec[0]*nvec[0] + nvec[1]*nvec[1]);
+    if(mag3<=0) {
+        cout<<"rotation axis is null"<<endl;
+        return;
+    }
+
+    double ctheta0=nvec[2]/mag3;
+    double stheta0=mag2/mag3;
+    double cphi0 = (mag2>0.) ? nvec[0]/mag2:0.;
+    double sphi0 = (mag2>0.) ? nvec[1]/mag2:0.;
+
+    rot_mat[0][0]=-ctheta0*cphi0;
+    rot_mat[0][1]=-ctheta0*sphi0;
+    rot_mat[0][2]=stheta0;
+    rot_mat[1][0]=sphi0;
+    rot_mat[1][1]=-1.*cphi0;
+    rot_mat[1][2]=0.;
+    rot_mat[2][0]=stheta0*cphi0;
+    rot_mat[2][1]=stheta0*sphi0;
+    rot_mat[2][2]=ctheta0;
+
+    return;
+}
+
+
+static double jetWidth(const SelectedJet& jet) {
+    double phi_jet = jet.momentum.phi();
+    double eta_jet = jet.momentum.eta();
+    double width = 0.0;
+    double pTsum = 0.0;
+    foreach (const Particle& p, jet.particles) {
+        double pT = p.momentum().pT();
+        double eta = p.momentum().eta();
+        double phi = p.momentum().phi();
+        width += sqrt(pow(phi_jet - phi,2) + pow(eta_jet - eta ,2)) * pT;
+        pTsum += pT;
+    }
+    if(pTsum != 0)return width/pTsum;
+    else return 0.0;
+}
+
+/// All four shapes from one pass over the particles, accumulating
+/// the moments each of them needs. Same definitions, quirks included,
+/// as getEcc(), getPFlow(), jetWidth() and getAngularity() below:
+///  - eccentricity: the energy weighted (dEta, dPhi) tensor of the
+///    positions shifted by the mean eta (not the mean dEta), its
+///    eigenvalues in closed form instead of rotating to the principal
+///    axes,
+///  - planar flow: the two transverse rows of the rotation matrix
+///    applied to each momentum, no rotated FourMomentum,
+///  - width: no phi wrapping,
+///  - angularity (a = -2): sin^-2(theta) (1-cos(theta))^3 is
+///    (1-cos)^2/(1+cos), with cos(theta) from the dot product.
+static SubstructureObservables::JetShapes getJetShapes(const SelectedJet& jet) {
+    const FourMomentum& J = jet.momentum;
+    const double etaJ = J.eta(), phiJ = J.phi(), mJ = J.mass();
+    const double pJ = sqrt(J.px()*J.px() + J.py()*J.py() + J.pz()*J.pz());
+
+    double nref[3];
+    nref[0] = cos(phiJ)/cosh(etaJ);
+    nref[1] = sin(phiJ)/cosh(etaJ);
+    nref[2] = tanh(etaJ);
+    double R[3][3];
+    CalcRotationMatrix(nref, R);
+
+    // sums of E, E*eta, E*u, E*v, E*u^2, E*v^2, E*u*v with u = dEta, v = dPhi
+    double sE = 0., sEeta = 0., su = 0., sv = 0., suu = 0., svv = 0., suv = 0.;
+    double Iw00 = 0., Iw01 = 0., Iw11 = 0.;
+    double width = 0., pTsum = 0.;
+    double sumAng = 0.;
+    foreach (const Particle& p, jet.particles) {
+        const FourMomentum& mom = p.momentum();
+        const double E = mom.E(), px = mom.px(), py = mom.py(), pz = mom.pz();
+        const double eta = mom.eta(), phi = mom.phi(), pT = mom.pT();
+
+        const double u = etaJ - eta;
+        double v = phiJ - phi;
+        if( fabs( v - TWOPI ) < fabs(v) ) v -= TWOPI;
+        else if( fabs(v + TWOPI) < fabs(v) ) v += TWOPI;
+        sE += E;
+        sEeta += E*eta;
+        su += E*u;
+        sv += E*v;
+        suu += E*u*u;
+        svv += E*v*v;
+        suv += E*u*v;
+
+        if(E != 0.) {
+            const double x = R[0][0]*px + R[0][1]*py + R[0][2]*pz;
+            const double y = R[1][0]*px + R[1][1]*py + R[1][2]*pz;
+            Iw00 += x*x/E;
+            Iw01 += x*y/E;
+            Iw11 += y*y/E;
+        }
+
+        width += sqrt(u*u + (phiJ - phi)*(phiJ - phi)) * pT;
+        pTsum += pT;
+
+        const double pp = sqrt(px*px + py*py + pz*pz);
+        if(pp*pJ != 0.) {
+            const double c = (J.px()*px + J.py()*py + J.pz()*pz)/(pp*pJ);
+            if(c > -1. && c < 1.) sumAng += E*(1. - c)*(1. - c)/(1. + c);
+        }
+    }
+
+    SubstructureObservables::JetShapes shapes;
+
+    const double a = (sE != 0.) ? sEeta/sE : 0.;
+    const double b = (sE != 0.) ? sv/sE : 0.;
+    const double Sxx = suu - 2.*a*su + a*a*sE;
+    const double Syy = svv - 2.*b*sv + b*b*sE;
+    const double Sxy = suv - a*sv - b*su + a*b*sE;
+    const double halfTrace = 0.5*(Sxx + Syy);
+    const double root = sqrt(0.25*(Sxx - Syy)*(Sxx - Syy) + Sxy*Sxy);
+    const double lMax = halfTrace + root, lMin = halfTrace - root;
+    shapes.ecc = (lMax != 0.) ? 1.0 - lMin/lMax : 0.;
+
+    // 1/m drops out of det/trace^2, only needed to skip massless jets
+    const double trace = Iw00 + Iw11;
+    shapes.pflow = (mJ != 0. && trace != 0.) ? 4.0*(Iw00*Iw11 - Iw01*Iw01)/(trace*trace) : 0.;
+
+    shapes.width = (pTsum != 0.) ? width/pTsum : 0.;
+    shapes.angularity = (mJ != 0.) ? sumAng/mJ : 0.;
+    return shapes;
+}
+
+// This is the code for the eccentricity calculation, copied and adapted from Lily's code
+static double getEcc(const SelectedJet& jet) {
+
+    ScratchVector<double>::type phis;
+    ScratchVector<double>::type etas;
+    ScratchVector<double>::type energies;
+    phis.reserve(jet.particles.size());
+    etas.reserve(jet.particles.size());
+    energies.reserve(jet.particles.size());
+
+    double etaSum = 0.;
+    double phiSum = 0.;
+    double eTot = 0.;
+    foreach (const Particle& p, jet.particles) {
+
+        double E = p.momentum().E();
+        double eta = p.momentum().eta();
+
+        energies.push_back(E);
+        etas.push_back(jet.momentum.eta() - eta);
+
+        eTot   += E;
+        etaSum += eta * E;
+
+        double dPhi = jet.momentum.phi() - p.momentum().phi();
+        //if DPhi does not lie within 0 < DPhi < PI take 2*PI off DPhi
+        //this covers cases where DPhi is greater than PI
+        if( fabs( dPhi - TWOPI ) < fabs(dPhi) ) dPhi -= TWOPI;
+        //if DPhi does not lie within -PI < DPhi < 0 add 2*PI to DPhi
+        //this covers cases where DPhi is less than -PI
+        else if( fabs(dPhi + TWOPI) < fabs(dPhi) ) dPhi += TWOPI;
+
+        phis.push_back(dPhi);
+
+        phiSum += dPhi * E;
+    }
+
+    //these are the "pull" away from the jet axis
+    if(eTot != 0) {
+        etaSum = etaSum/eTot;
+        phiSum = phiSum/eTot;
+    }
+    else 	   {
+        etaSum = 0;
+        phiSum = 0;
+    }
+
+    // now for every cluster we alter its position by moving it:
+    // away from the new axis if it is in the direction of -ve pull
+    // closer to the new axis if it is in the direction of +ve pull
+    // the effect of this will be that the new energy weighted center will be on the old jet axis.
+    double little_x=0., little_y=0.;
+    for(unsigned int k = 0; k< jet.particles.size(); k++) {
+        little_x+= etas[k]-etaSum;
+        little_y+= phis[k]-phiSum;
+
+        etas[k] = etas[k]-etaSum;
+        phis[k] = phis[k]-phiSum;
+    }
+
+    double X1=0.;
+    double X2=0.;
+    for(unsigned int i = 0; i < jet.particles.size(); i++) {
+        X1 += 2. * energies[i]* etas[i] * phis[i]; // this is =2*X*Y
+        X2 += energies[i]*(phis[i] * phis[i] - etas[i] * etas[i] ); // this isX^2 - Y^2
+    }
+
+    // variance calculations
+    double Theta = .5*atan2(X1,X2);
+
+    double sinTheta =sin(Theta);
+    double cosTheta = cos(Theta);
+    double Theta2 = Theta + 0.5*PI;
+    double sinThetaPrime = sin(Theta2);
+    double cosThetaPrime = cos(Theta2);
+
+    double VarX = 0.;
+    double VarY = 0.;
+    for(unsigned int i = 0; i < jet.particles.size(); i++) {
+        double X=sinTheta*etas[i] + cosTheta*phis[i];
+        double Y=sinThetaPrime*etas[i] + cosThetaPrime*phis[i];
+        VarX += energies[i]*X*X;
+        VarY += energies[i]*Y*Y;
+    }
+
+    double VarianceMax = VarX;
+    double VarianceMin = VarY;
+
+    if(VarianceMax < VarianceMin) {
+        VarianceMax = VarY;
+        VarianceMin = VarX;
+    }
+
+    double ECC;
+    if(VarianceMax != 0)ECC=1.0 - (VarianceMin/VarianceMax);
+    else ECC = 0;
+    return ECC;
+}
+
+// This is the code for the planar flow calculation, copied and adapted from Lily's code
+static double getPFlow(const SelectedJet& jet) {
+    double phi0=jet.momentum.phi();
+    double eta0=jet.momentum.eta();
+
+    double nref[3];
+    if(cosh(eta0) != 0)nref[0]=(cos(phi0)/cosh(eta0));
+    else nref[0] = 0;
+    if(cosh(eta0) != 0)nref[1]=(sin(phi0)/cosh(eta0));
+    else nref[1] = 0;
+    nref[2]=tanh(eta0);
+
+    // This is the rotation matrix
+    double RotationMatrix[3][3];
+    CalcRotationMatrix(nref, RotationMatrix);
+
+    double Iw00(0.), Iw01(0.), Iw11(0.), Iw10(0.);
+
+    foreach (const Particle& p, jet.particles) {
+        if(p.momentum().E()*jet.momentum.mass() == 0.)continue;
+        double a=1./(p.momentum().E()*jet.momentum.mass());
+        FourMomentum rotclus = RotateAxes(p.momentum(), RotationMatrix);
+        Iw00 += a*pow(rotclus.px(), 2);
+        Iw01 += a*rotclus.px()*rotclus.py();
+        Iw10 += a*rotclus.py()*rotclus.px();
+        Iw11 += a*pow(rotclus.py(), 2);
+    }
+
+    double det=Iw00*Iw11-Iw01*Iw10;
+    double trace=Iw00+Iw11;
+    double pf;
+    if(trace != 0)pf=(4.0*det)/(pow(trace,2));
+    else pf = 0;
+
+    return pf;
+}
+
+
+// This is the code for the angularity calculation, copied and adapted from Lily's code
+static double getAngularity(const SelectedJet& jet) {
+    double sum_a=0.;
+    //This a used in angularity calc can take any value <2 (e.g. 1,0,-0.5 etc) for infrared safety
+    const double a=-2.;
+
+    foreach (const Particle& p, jet.particles) {
+        double e_i       = p.momentum().E();
+        double theta_i   = jet.momentum.angle(p.momentum());
+        double e_theta_i;
+        if(sin(theta_i) == 0.) e_theta_i = 0;
+        else e_theta_i = e_i * pow(sin(theta_i),a) * pow(1-cos(theta_i),1-a);
+        sum_a += e_theta_i;
+    }
+
+    double Angularity;
+
+    if(jet.momentum.mass() != 0)Angularity = sum_a/jet.momentum.mass();//mass is in MeV
+    else Angularity = 0.0;
+    return Angularity;
+}
+
+SubstructureObservables::SubstructureObservables()
+    : meshsize(50), Rmax(2.), _m_21subjet(0), _m_32subjet(0), _m_FiltMass(0), _m_TrimMass(0),
+      _m_PrunMass(0), _preVetoEnabled(false), _preVetoed(false)
+{
+    _nPreVeto[0] = _nPreVeto[1] = 0;
+    _nEvents = _nSelected = 0;
+}
+
+void SubstructureObservables::book(HistogramBackend& backend) {
+    //the pre-veto is not a strict bound, so it is opt in; validating it
+    //clusters the vetoed events as well, for a check on one sample
+    _validatePreVeto = OptionInt("PREVETO_VALIDATE", 0) != 0;
+    _preVetoEnabled = _validatePreVeto || OptionInt("PREVETO", 0) != 0;
+    _validateShapes = OptionInt("SHAPES_VALIDATE", 0) != 0;
+    _shapesMaxDev = 0.;
+    _radii.configure("SUBSTRUCTURE");
+
+    //stuff from adapted code, ungroomed mass, pt, sqrt(d_{12})
+
+    _h_njets = backend.bookMultiWeight("njets", 3, 0, 3);
+    _h_jetmass = backend.bookMultiWeight("jetmass", 50, 0, 250);
+    _h_jetpt = backend.bookMultiWeight("jetpt", 50, 350, 600);
+    _h_jetd12 = backend.bookMultiWeight("jetd_12", 50, 0, 200);
+    _h_jetd23 = backend.bookMultiWeight("jetd_23", 50, 0, 200);
+    _h_ecc = backend.bookMultiWeight("Eccentricity", 50, 0, 1);
+    _h_width = backend.bookMultiWeight("Width", 50, 0, 1);
+    _h_pflow = backend.bookMultiWeight("PFlow", 50, 0, 1);
+    _h_angularity = backend.bookMultiWeight("Angularity", 50, 0, 0.1);
+
+    //energy correlation function ratios, beta and truncation configurable
+    //via JETSTUDY_ECF_BETA and JETSTUDY_ECF_MAXN (hardest constituents kept
+    //for e2, e3 and e4, 0 = all of them)
+
+    _ecfBeta = OptionDouble("ECF_BETA", 1.);
+    _thinning.configure("SUBSTRUCTURE");
+    _precision.configure();
+    _ecfMaxN = OptionInt("ECF_MAXN", ECFDefaultMaxN);
+    _h_ECF_C2 = backend.bookMultiWeight("ECF_C2", 50, 0, 0.6);
+    _h_ECF_D2 = backend.bookMultiWeight("ECF_D2", 50, 0, 5);
+    _h_ECF_C3 = backend.bookMultiWeight("ECF_C3", 50, 0, 0.6);
+
+    //R scan histos, same selection at every radius
+    for(unsigned int i = 0; i < _radii.size(); i++) {
+        const string sfx = _radii.suffix(i);
+        _h_R_jetmass.push_back(backend.bookMultiWeight("jetmass" + sfx, 50, 0, 250));
+        _h_R_jetpt.push_back(backend.bookMultiWeight("jetpt" + sfx, 50, 350, 600));
+        _h_R_32subjet.push_back(backend.bookMultiWeight("Tau_32" + sfx, 50, 0, 1.2));
+        _h_R_ECF_D2.push_back(backend.bookMultiWeight("ECF_D2" + sfx, 50, 0, 5));
+    }
+
+    //grooming histos
+
+    _h_FiltMass = backend.bookMultiWeight("Filtered_mass", 50, 0, 250);
+    _h_TrimMass = backend.bookMultiWeight("Trimmed_mass", 50, 0, 250);
+    _h_PrunMass = backend.bookMultiWeight("Pruned_mass", 50, 0, 250);
+
+    //n-subjettiness histos
+
+    _h_32subjet = backend.bookMultiWeight("Tau_32", 50, 0, 1.2);
+    _h_21subjet = backend.bookMultiWeight("Tau_21", 50, 0, 1.2);
+    _h_3subjet = backend.bookMultiWeight("Tau_3", 50, 0, 1);
+    _h_2subjet = backend.bookMultiWeight("Tau_2", 50, 0, 1);
+    _h_1subjet = backend.bookMultiWeight("Tau_1", 50, 0, 1);
+    _m_21subjet = &_moments["Tau_21"];
+    _m_32subjet = &_moments["Tau_32"];
+    _m_FiltMass = &_moments["Filtered_mass"];
+    _m_TrimMass = &_moments["Trimmed_mass"];
+    _m_PrunMass = &_moments["Pruned_mass"];
+
+    //ASF histos
+
+    _h_ASF_1peak_m = backend.bookMultiWeight("1_peak_m", 50, 0, 200);
+    _h_ASF_1peak_r = backend.bookMultiWeight("1_peak_r", 50, 0, 2);
+    _h_ASF_2peak_m1 = backend.bookMultiWeight("2_peak_m1", 50, 0, 200);
+    _h_ASF_2peak_r1 = backend.bookMultiWeight("2_peak_r1", 50, 0, 2);
+    _h_ASF_2peak_m2 = backend.bookMultiWeight("2_peak_m2", 50, 0, 200);
+    _h_ASF_2peak_r2 = backend.bookMultiWeight("2_peak_r2", 50, 0, 2);
+    _h_ASF_3peak_m1 = backend.bookMultiWeight("3_peak_m1", 50, 0, 200);
+    _h_ASF_3peak_r1 = backend.bookMultiWeight("3_peak_r1", 50, 0, 2);
+    _h_ASF_3peak_m2 = backend.bookMultiWeight("3_peak_m2", 50, 0, 200);
+    _h_ASF_3peak_r2 = backend.bookMultiWeight("3_peak_r2", 50, 0, 2);
+    _h_ASF_3peak_m3 = backend.bookMultiWeight("3_peak_m3", 50, 0, 200);
+    _h_ASF_3peak_r3 = backend.bookMultiWeight("3_peak_r3", 50, 0, 2);
+    _h_npeaks = backend.bookMultiWeight("npeaks", 4, 0, 4);
+
+    /// Average ASF histo: values defined in the constructor above.
+
+    _h_averageasf = backend.bookMultiWeight("averageasf", meshsize, 0, Rmax);
+    _h_averageasf_num = backend.bookMultiWeight("averageasf_num", meshsize, 0, Rmax);
+    _h_averageasf_den = backend.bookMultiWeight("averageasf_den", meshsize, 0, Rmax);
+}
+
+void SubstructureObservables::booked(std::map<std::string, MultiWeightHisto1D*>& histos) {
+    histos["njets"] = &_h_njets;
+    histos["jetmass"] = &_h_jetmass;
+    histos["jetpt"] = &_h_jetpt;
+    histos["jetd_12"] = &_h_jetd12;
+    histos["jetd_23"] = &_h_jetd23;
+    histos["Eccentricity"] = &_h_ecc;
+    histos["Width"] = &_h_width;
+    histos["PFlow"] = &_h_pflow;
+    histos["Angularity"] = &_h_angularity;
+    histos["Filtered_mass"] = &_h_FiltMass;
+    histos["Trimmed_mass"] = &_h_TrimMass;
+    histos["Pruned_mass"] = &_h_PrunMass;
+    histos["Tau_32"] = &_h_32subjet;
+    histos["Tau_21"] = &_h_21subjet;
+    histos["Tau_3"] = &_h_3subjet;
+    histos["Tau_2"] = &_h_2subjet;
+    histos["Tau_1"] = &_h_1subjet;
+    histos["1_peak_m"] = &_h_ASF_1peak_m;
+    histos["1_peak_r"] = &_h_ASF_1peak_r;
+    histos["2_peak_m1"] = &_h_ASF_2peak_m1;
+    histos["2_peak_r1"] = &_h_ASF_2peak_r1;
+    histos["2_peak_m2"] = &_h_ASF_2peak_m2;
+    histos["2_peak_r2"] = &_h_ASF_2peak_r2;
+    histos["3_peak_m1"] = &_h_ASF_3peak_m1;
+    histos["3_peak_r1"] = &_h_ASF_3peak_r1;
+    histos["3_peak_m2"] = &_h_ASF_3peak_m2;
+    histos["3_peak_r2"] = &_h_ASF_3peak_r2;
+    histos["3_peak_m3"] = &_h_ASF_3peak_m3;
+    histos["3_peak_r3"] = &_h_ASF_3peak_r3;
+    histos["npeaks"] = &_h_npeaks;
+    histos["ECF_C2"] = &_h_ECF_C2;
+    histos["ECF_D2"] = &_h_ECF_D2;
+    histos["ECF_C3"] = &_h_ECF_C3;
+    for(unsigned int i = 0; i < _radii.size(); i++) {
+        histos["jetmass" + _radii.suffix(i)] = &_h_R_jetmass[i];
+        histos["jetpt" + _radii.suffix(i)] = &_h_R_jetpt[i];
+        histos["Tau_32" + _radii.suffix(i)] = &_h_R_32subjet[i];
+        histos["ECF_D2" + _radii.suffix(i)] = &_h_R_ECF_D2[i];
+    }
+    histos["averageasf_num"] = &_h_averageasf_num;
+    histos["averageasf_den"] = &_h_averageasf_den;
+}
+
+bool SubstructureObservables::preVeto(const ParticleVector& particles, const EventWeights& weight) {
+    _nEvents++;
+    if(!_preVetoEnabled) return false;
+    JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "pre-veto", particles.size());
+    _preVetoed = MaxConePt(particles, max(1.2, _radii.maxRadius()), 4.0) < 350*GeV;
+    if(!_preVetoed) return false;
+    _nPreVeto[0]++;
+    if(_validatePreVeto) return false;
+    _h_njets.fill(0, weight);
+    return true;
+}
+
+void SubstructureObservables::analyzeRadii(const FastJets& camJets, const EventWeights& weight) {
+    JETSTUDY_TIME("MC_GENSTUDY_JET_SUBSTRUCTURE", "radii");
+    for(unsigned int i = 0; i < _radii.size(); i++) {
+        const double R = _radii.radius(i);
+        _radii.jets(camJets, i, 350*GeV, _radiusJets);
+        SelectJets(camJets, _radiusJets, 140*GeV, 250*GeV, 2, _radiusSelected);
+        foreach (const SelectedJet& jet, _radiusSelected) {
+            _h_R_jetmass[i].fill(jet.momentum.mass()/GeV, weight);
+            _h_R_jetpt[i].fill(jet.momentum.pT()/GeV, weight);
+            const PseudoJets& constituents = jet.constituents;
+            if(constituents.size() < 3) continue;
+            PseudoJets axis2 = GetAxes(camJets.clusterSeq(), 2, constituents, FastJets::KT, M_PI/2.0);
+            PseudoJets axis3 = GetAxes(camJets.clusterSeq(), 3, constituents, FastJets::KT, M_PI/2.0);
+            UpdateAxes(1, constituents, axis2);
+            UpdateAxes(1, constituents, axis3);
+            const double tau2 = TauValue(1, R, constituents, axis2);
+            const double tau3 = TauValue(1, R, constituents, axis3);
+            if(tau2 != 0) _h_R_32subjet[i].fill(tau3/tau2, weight);
+            if(_precision.enabled() && tau2 != 0) {
+                const double ref2 = TauValue<double>(1, R, constituents, axis2);
+                const double ref3 = TauValue<double>(1, R, constituents, axis3);
+                if(ref2 != 0)
+                    _precision.compare("Tau_32" + _radii.suffix(i), _h_R_32subjet[i].binWidth(), tau3/tau2, ref3/ref2);
+            }
+            const JetPairCache pairs(_thinning.apply(constituents));
+            _h_R_ECF_D2[i].fill(EnergyCorrelations(pairs, _ecfBeta, _ecfMaxN).D2, weight);
+        }
+    }
+}
+
+/// Check the fused kernel against the per-shape functions, relative to
+/// the size of each shape where that is above one
+void SubstructureObservables::compareShapes(const SelectedJet& jet, const JetShapes& shapes) {
+    const double ref[4] = {getEcc(jet), getPFlow(jet), jetWidth(jet), getAngularity(jet)};
+    const double fused[4] = {shapes.ecc, shapes.pflow, shapes.width, shapes.angularity};
+    for(unsigned int i = 0; i < 4; i++) {
+        const double dev = fabs(fused[i] - ref[i])/max(1., fabs(ref[i]));
+        if(dev > _shapesMaxDev) _shapesMaxDev = dev;
+        if(dev > 1e-8)
+            cerr << "Jet shape " << i << " deviates: " << fused[i] << " vs " << ref[i] << endl;
+    }
+}
+
+void SubstructureObservables::analyze(const FastJets& jetProjection, const FastJets* camJets,
+                                      const EventWeights& weight) {
+    //Require p_T > 350 GeV and 140 GeV < m_J < 250 GeV to make sure we are mainly looking
+    //at boosted tops. Only take two highest p_T jets which satisfy requirements.
+    //Every block below works on these records, nothing is extracted twice.
+    using namespace fastjet;
+    {
+        JETSTUDY_TIME("MC_GENSTUDY_JET_SUBSTRUCTURE", "jet selection");
+        SelectJets(jetProjection, 350*GeV, 140*GeV, 250*GeV, 2, _jets);
+    }
+    JETSTUDY_COUNT("MC_GENSTUDY_JET_SUBSTRUCTURE", "selected jets", _jets.size());
+    if(!_jets.empty()) _nSelected++;
+    if(_preVetoed && !_jets.empty()) {
+        _nPreVeto[1]++;
+        cerr << "Pre-veto rejected an event with a selected "
+             << _jets.front().momentum.pT()/GeV << " GeV jet" << endl;
+    }
+
+    _h_njets.fill(_jets.size(), weight);
+
+    if(camJets) analyzeRadii(*camJets, weight);
+
+    //Plot eccentricity etc
+    foreach(const SelectedJet& j, _jets) {
+        JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "shapes", j.constituents.size());
+        const JetShapes shapes = getJetShapes(j);
+        if(_validateShapes) compareShapes(j, shapes);
+        _h_ecc.fill(shapes.ecc, weight);
+        _h_width.fill(shapes.width, weight);
+        _h_angularity.fill(shapes.angularity, weight);
+        _h_pflow.fill(shapes.pflow, weight);
+        _h_jetmass.fill(j.momentum.mass()/GeV, weight);
+        _h_jetpt.fill(j.momentum.pT()/GeV, weight);
+    }
+
+    // Grooming algorithms and d_12/23
+    foreach (const SelectedJet& jet, _jets) {
+        const PseudoJet& pjet = jet.pseudoJet;
+        const PseudoJets& constituents = jet.constituents;
+
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "grooming", constituents.size());
+            const double filtMass = Filter(jetProjection.clusterSeq(),pjet, FastJets::CAM, 3, 0.3).m();
+            const double trimMass = Trimmer(jetProjection.clusterSeq(),pjet, FastJets::CAM, 0.03, 0.3).m();
+            const double prunMass = Pruner(jetProjection.clusterSeq(),pjet, FastJets::CAM, 0.1, pjet.m()/pjet.pt()).m();
+            _h_FiltMass.fill(filtMass, weight);
+            _h_TrimMass.fill(trimMass, weight);
+            _h_PrunMass.fill(prunMass, weight);
+            _m_FiltMass->fill(filtMass, weight[0]);
+            _m_TrimMass->fill(trimMass, weight[0]);
+            _m_PrunMass->fill(prunMass, weight[0]);
+        }
+
+        //Recluster using kt algorithm, use R=100 to make sure all particles are included.
+        //Make sure only one jet is returned otherwise something weird happened.
+        //Check correct number of subjets returned (possibly too few particles in jet).
+        //Use the two last stages of clustering to get sqrt(d_12) and sqrt(d_23).
+        JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "kt splitting", constituents.size());
+        JetDefinition jet_def(kt_algorithm, 100);
+        ClusterSequence cs(constituents, jet_def);
+        PseudoJets ktjet = sorted_by_pt(cs.inclusive_jets());
+        if (ktjet.size() != 1)continue;
+        PseudoJets subs2 = ktjet[0].exclusive_subjets_up_to(2);
+        PseudoJets subs3 = ktjet[0].exclusive_subjets_up_to(3);
+        if (subs2.size() != 2 || subs3.size() != 3)continue;
+        double d_12 = subs2[0].kt_distance(subs2[1]);
+        double d_23 = min(subs3[0].kt_distance(subs3[1]), subs3[0].kt_distance(subs3[2]));
+        d_23 = min(d_23, subs3[1].kt_distance(subs3[2]));
+        _h_jetd12.fill(sqrt(d_12), weight);
+        _h_jetd23.fill(sqrt(d_23), weight);
+    }
+
+    //N-subjettiness, use beta = 1 since dealing with tops (and for simplifying
+    //minimisation procedure)
+    foreach (const SelectedJet& jet, _jets) {
+        const PseudoJets& constituents = jet.constituents;
+        if(constituents.size() < 3) continue;
+        JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "n-subjettiness", constituents.size());
+        PseudoJets axis1 = GetAxes(jetProjection.clusterSeq(), 1, constituents, FastJets::KT, M_PI/2.0);
+        PseudoJets axis2 = GetAxes(jetProjection.clusterSeq(), 2, constituents, FastJets::KT, M_PI/2.0);
+        PseudoJets axis3 = GetAxes(jetProjection.clusterSeq(), 3, constituents, FastJets::KT, M_PI/2.0);
+        //Lloyd algorithm for local minimum, only need one run since beta = 1
+        UpdateAxes(1, constituents, axis1);
+        UpdateAxes(1, constituents, axis2);
+        UpdateAxes(1, constituents, axis3);
+        //plot Tau values
+        double tau1 = TauValue(1, 1.2, constituents, axis1);
+        double tau2 = TauValue(1, 1.2, constituents, axis2);
+        double tau3 = TauValue(1, 1.2, constituents, axis3);
+        _h_1subjet.fill(tau1, weight);
+        _h_2subjet.fill(tau2, weight);
+        _h_3subjet.fill(tau3, weight);
+        if(tau1 != 0) {
+            _h_21subjet.fill(tau2/tau1, weight);
+            _m_21subjet->fill(tau2/tau1, weight[0]);
+        }
+        if(tau2 != 0) {
+            _h_32subjet.fill(tau3/tau2, weight);
+            _m_32subjet->fill(tau3/tau2, weight[0]);
+        }
+        if(_precision.enabled()) {
+            const double ref1 = TauValue<double>(1, 1.2, constituents, axis1);
+            const double ref2 = TauValue<double>(1, 1.2, constituents, axis2);
+            const double ref3 = TauValue<double>(1, 1.2, constituents, axis3);
+            _precision.compare("Tau_1", _h_1subjet.binWidth(), tau1, ref1);
+            _precision.compare("Tau_2", _h_2subjet.binWidth(), tau2, ref2);
+            _precision.compare("Tau_3", _h_3subjet.binWidth(), tau3, ref3);
+            if(tau1 != 0 && ref1 != 0) _precision.compare("Tau_21", _h_21subjet.binWidth(), tau2/tau1, ref2/ref1);
+            if(tau2 != 0 && ref2 != 0) _precision.compare("Tau_32", _h_32subjet.binWidth(), tau3/tau2, ref3/ref2);
+        }
+    }
+
+    //Energy correlations, ASF peaks & average ASF, all from one set of pairs
+    foreach (const SelectedJet& jet, _jets) {
+        const PseudoJets& constituents = jet.constituents;
+        if (constituents.size() < 3) continue;
+        JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "pairs, ECF and ASF", constituents.size());
+        //optionally thinned, for the pair based observables only
+        const JetPairCache pairs(_thinning.apply(constituents));
+
+        ECFResult ecf;
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "energy correlations", pairs.size());
+            ecf = EnergyCorrelations(pairs, _ecfBeta, _ecfMaxN);
+        }
+        _h_ECF_C2.fill(ecf.C2, weight);
+        _h_ECF_D2.fill(ecf.D2, weight);
+        _h_ECF_C3.fill(ecf.C3, weight);
+        if(_ecfMaxN) {
+            //what the truncation may have left out, see print()
+            _moments.fill("ECF_e2", ecf.e2, weight[0]);
+            _moments.fill("ECF_e2Error", ecf.e2Error, weight[0]);
+            _moments.fill("ECF_e3", ecf.e3, weight[0]);
+            _moments.fill("ECF_e3Error", ecf.e3Error, weight[0]);
+            _moments.fill("ECF_e4", ecf.e4, weight[0]);
+            _moments.fill("ECF_e4Error", ecf.e4Error, weight[0]);
+        }
+
+        //require min prominence = 4.0
+        vector<ACFpeak> peaks = ASFPeaks(pairs, 0, 4.0);
+        if(_thinning.validating() && _thinning.thinned()) {
+            const JetPairCache fullPairs(constituents);
+            const ECFResult fullEcf = EnergyCorrelations(fullPairs, _ecfBeta, _ecfMaxN);
+            _thinning.compare("C2", ecf.C2, fullEcf.C2);
+            _thinning.compare("D2", ecf.D2, fullEcf.D2);
+            _thinning.compare("C3", ecf.C3, fullEcf.C3);
+            const vector<ACFpeak> fullPeaks = ASFPeaks(fullPairs, 0, 4.0);
+            _thinning.compare("npeaks", peaks.size(), fullPeaks.size());
+            if(!peaks.empty() && !fullPeaks.empty())
+                _thinning.compare("1st peak R", peaks[0].Rval, fullPeaks[0].Rval);
+        }
+        if(_precision.enabled()) {
+            //a peak moving across the prominence cut changes the count, so
+            //positions and masses are only compared when the counts agree
+            const vector<ACFpeak> refPeaks = ASFPeaks<double>(pairs, 0, 4.0);
+            _precision.compare("npeaks", _h_npeaks.binWidth(), peaks.size(), refPeaks.size());
+            //named after the histograms they fill, which all share one binning
+            if(peaks.size() == refPeaks.size() && peaks.size() <= 3) {
+                for(unsigned int i = 0; i < peaks.size(); i++) {
+                    const std::string histo = std::string(1, char('0' + peaks.size())) + "_peak_";
+                    const std::string index = peaks.size() == 1 ? "" : std::string(1, char('1' + i));
+                    _precision.compare(histo + "r" + index, _h_ASF_1peak_r.binWidth(), peaks[i].Rval, refPeaks[i].Rval);
+                    _precision.compare(histo + "m" + index, _h_ASF_1peak_m.binWidth(),
+                                       peaks[i].partialmass, refPeaks[i].partialmass);
+                }
+            }
+        }
+        _h_npeaks.fill(peaks.size(), weight);
+        if(peaks.size() == 1) {
+            _h_ASF_1peak_m.fill(peaks[0].partialmass, weight);
+            _h_ASF_1peak_r.fill(peaks[0].Rval, weight);
+        }
+        if(peaks.size() == 2) {
+            _h_ASF_2peak_m1.fill(peaks[0].partialmass, weight);
+            _h_ASF_2peak_r1.fill(peaks[0].Rval, weight);
+            _h_ASF_2peak_m2.fill(peaks[1].partialmass, weight);
+            _h_ASF_2peak_r2.fill(peaks[1].Rval, weight);
+        }
+        if(peaks.size() == 3) {
+            _h_ASF_3peak_m1.fill(peaks[0].partialmass, weight);
+            _h_ASF_3peak_r1.fill(peaks[0].Rval, weight);
+            _h_ASF_3peak_m2.fill(peaks[1].partialmass, weight);
+            _h_ASF_3peak_r2.fill(peaks[1].Rval, weight);
+            _h_ASF_3peak_m3.fill(peaks[2].partialmass, weight);
+            _h_ASF_3peak_r3.fill(peaks[2].Rval, weight);
+        }
+
+        /// Accumulate numerator and denominator of the average ASF, the
+        /// ratio is taken in finalize() or after merging jobs.
+        /// The histogram binning places each R value directly in
+        /// bin k with k*Rmax/meshsize <= R < (k+1)*Rmax/meshsize.
+        vector<vector<double> > angfuncs = ASF(pairs);
+        if(angfuncs.empty()) continue;
+        for(unsigned int j = 0; j < angfuncs[0].size(); j++) {
+            if(angfuncs[0][j] >= Rmax) break;
+            for(unsigned int i = 0; i < weight.size(); i++) {
+                _h_averageasf_num[i]->fill(angfuncs[0][j], weight[i]*angfuncs[1][j]);
+                _h_averageasf_den[i]->fill(angfuncs[0][j], weight[i]*angfuncs[2][j]);
+            }
+        }
+    }
+}
+
+void SubstructureObservables::finalize(HistogramBackend& backend) {
+    /// Fill in average ASF histo from the accumulated sums, separately
+    /// for every weight stream.
+    for(unsigned int i = 0; i < _h_averageasf.size(); i++) {
+        for(unsigned int k = 0; k < meshsize; k++) {
+            const double den = _h_averageasf_den[i]->binHeight(k);
+            if(den == 0) continue;
+            _h_averageasf[i]->fill( 0.001 + k * (Rmax/(double)meshsize), _h_averageasf_num[i]->binHeight(k)/den);
+        }
+
+        /// Rivet normalises by dividing by width of bin by default,
+        /// so reverse to get the true average ASF.
+        backend.scale(_h_averageasf[i], Rmax/(double)meshsize);
+    }
+
+    backend.normalize(_h_njets);
+    backend.normalize(_h_jetmass);
+    backend.normalize(_h_ecc);
+    backend.normalize(_h_width);
+    backend.normalize(_h_pflow);
+    backend.normalize(_h_angularity);
+    backend.normalize(_h_jetd12);
+    backend.normalize(_h_jetd23);
+
+    backend.normalize(_h_FiltMass);
+    backend.normalize(_h_TrimMass);
+    backend.normalize(_h_PrunMass);
+
+    backend.normalize(_h_21subjet);
+    backend.normalize(_h_32subjet);
+    backend.normalize(_h_1subjet);
+    backend.normalize(_h_2subjet);
+    backend.normalize(_h_3subjet);
+
+    backend.normalize(_h_ASF_1peak_m);
+    backend.normalize(_h_ASF_1peak_r);
+    backend.normalize(_h_ASF_2peak_m1);
+    backend.normalize(_h_ASF_2peak_r1);
+    backend.normalize(_h_ASF_2peak_m2);
+    backend.normalize(_h_ASF_2peak_r2);
+    backend.normalize(_h_ASF_3peak_m1);
+    backend.normalize(_h_ASF_3peak_r1);
+    backend.normalize(_h_ASF_3peak_m2);
+    backend.normalize(_h_ASF_3peak_r2);
+    backend.normalize(_h_ASF_3peak_m3);
+    backend.normalize(_h_ASF_3peak_r3);
+    backend.normalize(_h_npeaks);
+
+    backend.normalize(_h_ECF_C2);
+    backend.normalize(_h_ECF_D2);
+    backend.normalize(_h_ECF_C3);
+
+    for(unsigned int i = 0; i < _radii.size(); i++) {
+        backend.normalize(_h_R_jetmass[i]);
+        backend.normalize(_h_R_32subjet[i]);
+        backend.normalize(_h_R_ECF_D2[i]);
+    }
+}
+
+Instrumentation::CutFlow SubstructureObservables::cutFlow() const {
+    Instrumentation::CutFlow flow;
+    flow.push_back(std::make_pair(std::string("Inclusive"), _nEvents));
+    if(_preVetoEnabled) flow.push_back(std::make_pair(std::string("Pre-veto"), _nEvents - _nPreVeto[0]));
+    flow.push_back(std::make_pair(std::string("Selected jet"), _nSelected));
+    return flow;
+}
+
+void SubstructureObservables::print(std::ostream& os, const std::string& name) {
+    if(_preVetoEnabled) {
+        os << _nPreVeto[0] << " events vetoed before clustering";
+        if(_validatePreVeto) os << ", " << _nPreVeto[1] << " of them with a selected jet";
+        os << endl;
+    }
+    if(_validateShapes)
+        os << "Largest deviation of the fused jet shapes: " << _shapesMaxDev << endl;
+    _thinning.print(os, name);
+    _precision.print(os, name);
+    if(_ecfMaxN) PrintECFTruncation(os, _moments, _ecfMaxN);
+    _moments.print(os);
+}
+
+}
@@ -0,0 +1,34 @@
+/// Convert AIDA histogram files into an indexed binary histogram store.
+/// Usage: aida2hbin [in.aida] [out.hbin]
+///        aida2hbin -l [in.hbin]      list the contents of a store
+#include <cstring>
+#include <iostream>
+
+#include "HistoStore.h"
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && std::strcmp(argv[1], "-l") == 0) {
+        HistoStore::Reader reader;
+        if (!reader.open(argv[2])) return 1;
+        for (unsigned int i = 0; i < reader.size(); i++) {
+            HistoStore::HistoView view;
+            //an index out of order breaks the binary search
+            if (!reader.find(reader.path(i), view)) {
+                std::cerr << reader.path(i) << " cannot be looked up, the index is not sorted" << std::endl;
+                return 1;
+            }
+            std::cout << view.path << " " << view.nBins << std::endl;
+        }
+        return 0;
+    }
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " [in.aida] [out.hbin]" << std::endl;
+        std::cerr << "       " << argv[0] << " -l [in.hbin]" << std::endl;
+        return 1;
+    }
+    std::vector<HistoStore::Histogram> histos;
+    if (!HistoStore::ReadAIDA(argv[1], histos)) return 1;
+    if (!HistoStore::Write(argv[2], histos)) return 1;
+    std::cout << "Wrote " << histos.size() << " histograms to " << argv[2] << std::endl;
+    return 0;
+}
@@ -0,0 +1,115 @@
+/// Compare AIDA histogram files bin by bin against reference outputs.
+/// Usage: aidacompare [-p maxpull] [-c maxchi2] [reference.aida] [test.aida]
+///
+/// For every reference histogram the pulls (y - y_ref)/sqrt(err^2 + err_ref^2)
+/// of all bins are formed. A histogram fails if it is missing, its binning
+/// changed, any |pull| exceeds maxpull (default 5) or chi2/ndf exceeds
+/// maxchi2 (default 3). Bins where both errors are zero must agree exactly.
+/// The exit code is the number of failing histograms, capped at 99, or 100
+/// if the files cannot be read.
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "HistoStore.h"
+
+namespace {
+
+struct Comparison {
+    double chi2;
+    unsigned int ndf;
+    double maxPull;
+    unsigned int worstBin;
+    std::string problem;
+};
+
+Comparison Compare(const HistoStore::Histogram& ref, const HistoStore::Histogram& test) {
+    Comparison result;
+    result.chi2 = 0.;
+    result.ndf = 0;
+    result.maxPull = 0.;
+    result.worstBin = 0;
+    if (ref.bins.size() != test.bins.size()) {
+        result.problem = "binning changed";
+        return result;
+    }
+    for (unsigned int i = 0; i < ref.bins.size(); i++) {
+        const HistoStore::StoredBin& r = ref.bins[i];
+        const HistoStore::StoredBin& t = test.bins[i];
+        if (std::fabs(r.x - t.x) > 1e-6*(std::fabs(r.x) + r.xErrPlus)) {
+            result.problem = "binning changed";
+            return result;
+        }
+        const double errRef = 0.5*(r.yErrPlus + r.yErrMinus), errTest = 0.5*(t.yErrPlus + t.yErrMinus);
+        const double err2 = errRef*errRef + errTest*errTest;
+        double pull = 0.;
+        if (err2 > 0.) {
+            pull = (t.y - r.y)/std::sqrt(err2);
+            result.chi2 += pull*pull;
+            result.ndf++;
+        } else if (t.y != r.y) {
+            //no statistical excuse for a change
+            pull = HUGE_VAL;
+        }
+        if (std::fabs(pull) > std::fabs(result.maxPull)) {
+            result.maxPull = pull;
+            result.worstBin = i;
+        }
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    double maxPull = 5., maxChi2 = 3.;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (std::strcmp(argv[arg], "-p") == 0) maxPull = std::atof(argv[arg + 1]);
+        else if (std::strcmp(argv[arg], "-c") == 0) maxChi2 = std::atof(argv[arg + 1]);
+        else break;
+    }
+    if (argc - arg != 2) {
+        std::cerr << "Usage: " << argv[0] << " [-p maxpull] [-c maxchi2] [reference.aida] [test.aida]" << std::endl;
+        return 100;
+    }
+    std::vector<HistoStore::Histogram> refHistos, testHistos;
+    if (!HistoStore::ReadAIDA(argv[arg], refHistos)) return 100;
+    if (!HistoStore::ReadAIDA(argv[arg + 1], testHistos)) return 100;
+    std::map<std::string, const HistoStore::Histogram*> tests;
+    for (unsigned int i = 0; i < testHistos.size(); i++) tests[testHistos[i].path] = &testHistos[i];
+
+    unsigned int failed = 0;
+    for (unsigned int i = 0; i < refHistos.size(); i++) {
+        const HistoStore::Histogram& ref = refHistos[i];
+        std::map<std::string, const HistoStore::Histogram*>::iterator test = tests.find(ref.path);
+        if (test == tests.end()) {
+            std::cout << "FAIL " << ref.path << ": missing" << std::endl;
+            failed++;
+            continue;
+        }
+        const Comparison c = Compare(ref, *test->second);
+        tests.erase(test);
+        const double chi2ndf = c.ndf ? c.chi2/c.ndf : 0.;
+        if (!c.problem.empty()) {
+            std::cout << "FAIL " << ref.path << ": " << c.problem << std::endl;
+        } else if (std::fabs(c.maxPull) > maxPull || chi2ndf > maxChi2) {
+            std::cout << "FAIL " << ref.path << ": chi2/ndf " << std::setprecision(3) << c.chi2 << "/" << c.ndf
+                      << ", pull " << c.maxPull << " in bin " << c.worstBin
+                      << " (x = " << ref.bins[c.worstBin].x << ")" << std::endl;
+        } else {
+            continue;
+        }
+        failed++;
+    }
+    //new histograms are not an error, but should be blessed into the reference
+    for (std::map<std::string, const HistoStore::Histogram*>::iterator t = tests.begin(); t != tests.end(); ++t)
+        std::cout << "NEW  " << t->first << ": not in the reference" << std::endl;
+
+    std::cout << refHistos.size() - failed << "/" << refHistos.size() << " histograms compatible with "
+              << argv[arg] << std::endl;
+    return failed > 99 ? 99 : failed;
+}
@@ -0,0 +1,294 @@
+/// Microbenchmarks of the BOOSTFastJets observables on synthetic jets.
+/// Usage: benchBOOSTFastJets [-n 10,20,50] [-p prongs] [-s seconds]
+///                           [-o results.json] [-b baseline.json] [-t tolerance]
+///
+/// Every function is timed on jets with a fixed number of constituents
+/// spread around 1-3 hard prongs, for each requested constituent count.
+/// The JSON report holds ns/jet per function and count plus the fitted
+/// exponent of t ~ n^a.  With -b the run is compared to an earlier report
+/// and the exit code is 2 if any function got slower than the tolerance
+/// (fraction, default 0.25) allows.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <sys/time.h>
+
+#include "BOOSTFastJets.h"
+#include "ScratchArena.h"
+#include "fastjet/ClusterSequence.hh"
+
+using namespace Rivet;
+
+namespace {
+
+const double kJetPt = 500.;
+const double kJetR = 1.2;
+/// Distinct jets per constituent count, timed in turn
+const unsigned int kSamples = 16;
+
+double wallTime() {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+double gauss() {
+    const double u1 = drand48() + 1e-12, u2 = drand48();
+    return std::sqrt(-2.*std::log(u1))*std::cos(2.*M_PI*u2);
+}
+
+fastjet::PseudoJet masslessPtYPhi(double pt, double y, double phi) {
+    return fastjet::PseudoJet(pt*std::cos(phi), pt*std::sin(phi), pt*std::sinh(y), pt*std::cosh(y));
+}
+
+/// One clustered synthetic jet and what the observables take as input
+struct BenchJet {
+    fastjet::ClusterSequence* clusterSeq;
+    fastjet::PseudoJet jet;
+    PseudoJets constituents;
+    std::vector<double> charges;
+    PseudoJets axes;
+};
+
+/// n massless particles around nProngs hard axes within R = 0.8 of
+/// (y, phi) = (0, 1). The prong cores share half the jet pT, the soft
+/// particles have exponentially falling pT and sit within ~0.1 of their prong.
+BenchJet MakeJet(unsigned int n, unsigned int nProngs) {
+    std::vector<double> prongY(nProngs, 0.), prongPhi(nProngs, 1.);
+    for (unsigned int p = 1; p < nProngs; p++) {
+        const double dR = 0.3 + 0.4*drand48(), angle = 2.*M_PI*drand48();
+        prongY[p] = dR*std::cos(angle);
+        prongPhi[p] = 1. + dR*std::sin(angle);
+    }
+
+    PseudoJets particles;
+    std::vector<double> charges;
+    std::vector<double> pts(n);
+    double sumPt = 0.;
+    for (unsigned int i = 0; i < n; i++) sumPt += (pts[i] = -std::log(drand48() + 1e-12));
+    for (unsigned int i = 0; i < n; i++) {
+        const unsigned int p = i < nProngs ? i : static_cast<unsigned int>(drand48()*nProngs) % nProngs;
+        double y = prongY[p], phi = prongPhi[p];
+        if (i >= nProngs) {
+            y += 0.1*gauss();
+            phi += 0.1*gauss();
+        }
+        const double pt = i < nProngs ? 0.5*kJetPt/nProngs : 0.5*kJetPt*pts[i]/sumPt;
+        particles.push_back(masslessPtYPhi(pt, y, phi));
+        particles.back().set_user_index(i);
+        charges.push_back(static_cast<int>(3*drand48()) - 1);
+    }
+
+    BenchJet bench;
+    bench.clusterSeq = new fastjet::ClusterSequence(particles, fastjet::JetDefinition(fastjet::antikt_algorithm, kJetR));
+    bench.jet = sorted_by_pt(bench.clusterSeq->inclusive_jets())[0];
+    bench.constituents = bench.clusterSeq->constituents(bench.jet);
+    for (unsigned int i = 0; i < bench.constituents.size(); i++)
+        bench.charges.push_back(charges[bench.constituents[i].user_index()]);
+    bench.axes = GetAxes(bench.clusterSeq, 2, bench.constituents, FastJets::KT, M_PI/2.0);
+    return bench;
+}
+
+/// Results are summed here so the compiler cannot drop the calls
+volatile double gSink = 0.;
+
+/// The benchmarked functions, index matches kFunctionNames
+const char* const kFunctionNames[] = {
+    "Dipolarity", "JetPull", "JetCharge", "Filter", "Trimmer", "Pruner",
+    "GetAxes", "TauValue", "UpdateAxes", "JetPairCache", "EnergyCorrelations",
+    "ThinConstituents", "ASFPeaks", "ASF"
+};
+const unsigned int kNFunctions = sizeof(kFunctionNames)/sizeof(kFunctionNames[0]);
+
+void Run(unsigned int function, const BenchJet& b) {
+    switch (function) {
+    case 0: gSink += Dipolarity(b.jet); break;
+    case 1: gSink += JetPull(b.jet, b.constituents).first; break;
+    case 2: gSink += JetCharge(b.jet, b.constituents, &b.charges[0], 0.5); break;
+    case 3: gSink += Filter(b.clusterSeq, b.jet, FastJets::CAM, 3, 0.3).m(); break;
+    case 4: gSink += Trimmer(b.clusterSeq, b.jet, FastJets::CAM, 0.03, 0.3).m(); break;
+    case 5: gSink += Pruner(b.clusterSeq, b.jet, FastJets::CAM, 0.1, b.jet.m()/b.jet.pt()).m(); break;
+    case 6: gSink += GetAxes(b.clusterSeq, 2, b.constituents, FastJets::KT, M_PI/2.0).size(); break;
+    case 7: gSink += TauValue(1, kJetR, b.constituents, b.axes); break;
+    case 8: {
+        PseudoJets axes(b.axes);
+        UpdateAxes(1, b.constituents, axes);
+        gSink += axes[0].perp();
+        break;
+    }
+    case 9: gSink += JetPairCache(b.constituents).deltaR(0, b.constituents.size() - 1); break;
+    case 10: {
+        const JetPairCache pairs(b.constituents);
+        gSink += EnergyCorrelations(pairs).D2;
+        break;
+    }
+    case 11: {
+        ThinningSettings settings;
+        settings.budget = 0.05;
+        settings.mergeR = 0.1;
+        settings.threshold = 0;
+        PseudoJets thinned;
+        gSink += ThinConstituents(b.constituents, thinned, settings).after;
+        break;
+    }
+    case 12: gSink += ASFPeaks(b.constituents, 0, 4.0).size(); break;
+    case 13: gSink += ASF(b.constituents)[1].back(); break;
+    }
+}
+
+/// Mean time per call, cycling through the jets until minTime has passed
+double TimePerJet(unsigned int function, const std::vector<BenchJet>& jets, double minTime) {
+    //warm up the arena and the caches
+    for (unsigned int i = 0; i < jets.size(); i++) {
+        Run(function, jets[i]);
+        ScratchArena::local().reset();
+    }
+    unsigned long calls = 0;
+    const double start = wallTime();
+    double elapsed = 0.;
+    do {
+        for (unsigned int i = 0; i < jets.size(); i++) {
+            Run(function, jets[i]);
+            ScratchArena::local().reset();
+        }
+        calls += jets.size();
+        elapsed = wallTime() - start;
+    } while (elapsed < minTime);
+    return 1e9*elapsed/calls;
+}
+
+/// Least squares slope of log t against log n
+double ScalingExponent(const std::vector<double>& n, const std::vector<double>& t) {
+    double sx = 0., sy = 0., sxx = 0., sxy = 0.;
+    const unsigned int m = n.size();
+    for (unsigned int i = 0; i < m; i++) {
+        const double x = std::log(n[i]), y = std::log(t[i]);
+        sx += x;
+        sy += y;
+        sxx += x*x;
+        sxy += x*y;
+    }
+    const double den = m*sxx - sx*sx;
+    return (m < 2 || den <= 0.) ? 0. : (m*sxy - sx*sy)/den;
+}
+
+std::string Key(const std::string& function, unsigned int n) {
+    std::ostringstream key;
+    key << function << "/" << n;
+    return key.str();
+}
+
+/// ns/jet per function/constituents from a report written by this program
+bool ReadBaseline(const char* file, std::map<std::string, double>& baseline) {
+    std::ifstream in(file);
+    if (!in) {
+        std::cerr << "Cannot read baseline " << file << std::endl;
+        return false;
+    }
+    std::string line;
+    char function[64];
+    unsigned int n;
+    double ns;
+    while (std::getline(in, line)) {
+        if (std::sscanf(line.c_str(), " {\"function\": \"%63[^\"]\", \"constituents\": %u, \"ns_per_jet\": %lf",
+                        function, &n, &ns) == 3)
+            baseline[Key(function, n)] = ns;
+    }
+    return true;
+}
+
+std::vector<unsigned int> ParseCounts(const char* list) {
+    std::vector<unsigned int> counts;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (std::atoi(item.c_str()) > 0) counts.push_back(std::atoi(item.c_str()));
+    return counts;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<unsigned int> counts = ParseCounts("10,20,50,100,200,500");
+    unsigned int nProngs = 2;
+    double minTime = 0.2, tolerance = 0.25;
+    const char* output = 0;
+    const char* baselineFile = 0;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "-n") == 0) counts = ParseCounts(argv[++i]);
+        else if (hasValue && std::strcmp(argv[i], "-p") == 0) nProngs = std::atoi(argv[++i]);
+        else if (hasValue && std::strcmp(argv[i], "-s") == 0) minTime = std::atof(argv[++i]);
+        else if (hasValue && std::strcmp(argv[i], "-o") == 0) output = argv[++i];
+        else if (hasValue && std::strcmp(argv[i], "-b") == 0) baselineFile = argv[++i];
+        else if (hasValue && std::strcmp(argv[i], "-t") == 0) tolerance = std::atof(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [-n 10,20,50] [-p prongs] [-s seconds]"
+                      << " [-o results.json] [-b baseline.json] [-t tolerance]" << std::endl;
+            return 1;
+        }
+    }
+    if (counts.empty() || nProngs < 1 || nProngs > 3) {
+        std::cerr << "Need at least one constituent count and 1-3 prongs" << std::endl;
+        return 1;
+    }
+    std::map<std::string, double> baseline;
+    if (baselineFile && !ReadBaseline(baselineFile, baseline)) return 1;
+
+    //same jets on every run, so reports can be compared
+    srand48(12345);
+    std::vector<std::vector<BenchJet> > jets(counts.size());
+    std::vector<double> meanSize(counts.size(), 0.);
+    for (unsigned int c = 0; c < counts.size(); c++) {
+        for (unsigned int s = 0; s < kSamples; s++) {
+            jets[c].push_back(MakeJet(counts[c], nProngs));
+            meanSize[c] += jets[c].back().constituents.size()/double(kSamples);
+        }
+    }
+
+    std::ostringstream report;
+    report << "{\n  \"benchmark\": \"BOOSTFastJets\",\n  \"prongs\": " << nProngs
+           << ",\n  \"jets_per_point\": " << kSamples << ",\n  \"results\": [\n";
+    std::vector<std::vector<double> > times(kNFunctions, std::vector<double>(counts.size()));
+    unsigned int regressions = 0;
+    for (unsigned int f = 0; f < kNFunctions; f++) {
+        for (unsigned int c = 0; c < counts.size(); c++) {
+            const double ns = TimePerJet(f, jets[c], minTime);
+            times[f][c] = ns;
+            report << "    {\"function\": \"" << kFunctionNames[f] << "\", \"constituents\": " << counts[c]
+                   << ", \"ns_per_jet\": " << ns << ", \"mean_constituents\": " << meanSize[c] << "}"
+                   << (f + 1 == kNFunctions && c + 1 == counts.size() ? "" : ",") << "\n";
+            std::map<std::string, double>::const_iterator ref = baseline.find(Key(kFunctionNames[f], counts[c]));
+            if (ref == baseline.end() || ns <= (1. + tolerance)*ref->second) continue;
+            std::cerr << "Regression: " << kFunctionNames[f] << " at " << counts[c] << " constituents takes "
+                      << ns << " ns/jet, baseline " << ref->second << std::endl;
+            regressions++;
+        }
+    }
+    report << "  ],\n  \"scaling\": [\n";
+    for (unsigned int f = 0; f < kNFunctions; f++) {
+        report << "    {\"function\": \"" << kFunctionNames[f] << "\", \"exponent\": "
+               << ScalingExponent(meanSize, times[f]) << "}" << (f + 1 == kNFunctions ? "" : ",") << "\n";
+    }
+    report << "  ]\n}\n";
+
+    if (output) {
+        std::ofstream out(output);
+        out << report.str();
+        std::cout << "Wrote " << output << std::endl;
+    } else {
+        std::cout << report.str();
+    }
+    for (unsigned int c = 0; c < counts.size(); c++)
+        for (unsigned int s = 0; s < jets[c].size(); s++) delete jets[c][s].clusterSeq;
+    if (regressions) {
+        std::cerr << regressions << " timings above baseline by more than " << 100*tolerance << "%" << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+/// Convert generator output between ASCII HepMC and compact jcev files.
+/// Usage: jcevconvert [-f] [in.hepmc] [out.jcev]   -f stores float momenta
+///        jcevconvert [in.jcev] [out.hepmc]
+///        jcevconvert -l [in.jcev]                 print the file summary
+#include <cstring>
+#include <iostream>
+
+#include "EventStore.h"
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && std::strcmp(argv[1], "-l") == 0) {
+        EventStore::Reader reader;
+        if (!reader.open(argv[2])) return 1;
+        std::cout << reader.size() << " events" << std::endl;
+        for (unsigned int i = 0; i < reader.weightNames().size(); i++)
+            std::cout << "weight " << i << ": " << reader.weightNames()[i] << std::endl;
+        return 0;
+    }
+    const bool single = argc == 4 && std::strcmp(argv[1], "-f") == 0;
+    if (argc != 3 && !single) {
+        std::cerr << "Usage: " << argv[0] << " [-f] [in.hepmc] [out.jcev]" << std::endl;
+        std::cerr << "       " << argv[0] << " [in.jcev] [out.hepmc]" << std::endl;
+        std::cerr << "       " << argv[0] << " -l [in.jcev]" << std::endl;
+        return 1;
+    }
+    const int arg = single ? 2 : 1;
+    if (!EventStore::Convert(argv[arg], argv[arg + 1], single ? EventStore::kSinglePrecision : 0)) return 1;
+    std::cout << "Wrote " << argv[arg + 1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,282 @@
+/// Run the jet charge and substructure analyses over a jcev file without
+/// the Rivet runtime: no analysis handler, plugin loading or projection
+/// caching, only the particles, the W finder and the clustering. The
+/// histograms come from the same code as in the Rivet plugins (see
+/// JetChargeObservables and SubstructureObservables), are named alike and
+/// written in Rivet's AIDA layout; validation/crosscheck.sh compares the
+/// two. JETSTUDY_* options apply as in the plugins, checkpointing and
+/// convergence stops excepted.
+///
+/// For scaling tests -p overlays minimum bias events (e.g. generated with
+/// MonteCarloParams/Pythia8/minBias.cnf), final state and partons, on every
+/// event, k of them, where a list of k values is cycled event by event; -t
+/// writes the time each analysis took per event against the final state and
+/// parton multiplicities.
+/// Usage: jetstudyrun [-a analysis] [-n events] [-p pileup.jcev [-k k,...]]
+///                    [-t timing.csv] [in.jcev] [out.aida]
+///        -a MC_GENSTUDY_JETCHARGE or MC_GENSTUDY_JET_SUBSTRUCTURE, may be
+///           repeated, default both; -n stops after that many events;
+///        -k default 10
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "StandaloneAnalysis.h"
+#include "JetChargeObservables.h"
+#include "SubstructureObservables.h"
+#include "ScratchArena.h"
+#include "Instrumentation.h"
+#include "Rivet/Projections/FinalState.hh"
+#include "Rivet/Projections/FastJets.hh"
+#include "Rivet/Tools/ParticleIdUtils.hh"
+
+using namespace Rivet;
+
+namespace {
+
+double WallTime() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+/// The event loop of MC_GENSTUDY_JETCHARGE on plain particles
+class JetChargeRun {
+public:
+    explicit JetChargeRun(const WeightStreams& streams)
+        : _histos("/MC_GENSTUDY_JETCHARGE", streams),
+          _jets(FinalState(), FastJets::ANTIKT, 0.6), _camJets(0) {
+        for (unsigned int i = 0; i < 4; i++) _stageTime[i] = 0.;
+        _observables.book(_histos);
+        if (_observables.radii().enabled())
+            _camJets = new FastJets(FinalState(), FastJets::CAM, _observables.radii().maxRadius());
+    }
+    ~JetChargeRun() { delete _camJets; }
+
+    void analyze(const ParticleVector& finalState, const ParticleVector& partons, const EventWeights& weight) {
+        int* nPassing = _observables.nPassing();
+        nPassing[0]++;
+        double tStage = WallTime();
+        bool muonCandidate;
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "muon scan", finalState.size());
+            muonCandidate = JetChargeObservables::hasMuonCandidate(finalState);
+        }
+        tStage = lap(0, tStage);
+        if (!muonCandidate) return;
+        nPassing[1]++;
+        bool foundW;
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "W finder", finalState.size());
+            foundW = FindMuonW(finalState, _boson, _remaining);
+        }
+        tStage = lap(1, tStage);
+        if (!foundW) return;
+        nPassing[2]++;
+        const int wCharge = static_cast<int>(PID::charge(_boson.pdgId()));
+        if (_camJets) {
+            {
+                JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "radii clustering", _remaining.size());
+                _camJets->calc(_remaining);
+            }
+            _observables.analyzeRadii(*_camJets, wCharge, weight);
+        }
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JETCHARGE", "clustering", _remaining.size());
+            _jets.calc(_remaining);
+        }
+        tStage = lap(2, tStage);
+        //rejected events count towards the stage time too
+        _observables.analyzeJets(_jets, wCharge, partons, weight);
+        lap(3, tStage);
+    }
+
+    void finalize(std::vector<HistoStore::Histogram>& histos) {
+        _observables.printCutFlow(std::cout, _stageTime);
+        _observables.print(std::cout, "MC_GENSTUDY_JETCHARGE");
+        _observables.moments().report("MC_GENSTUDY_JETCHARGE");
+        JETSTUDY_REPORT("MC_GENSTUDY_JETCHARGE", _observables.cutFlow());
+        _histos.collect(histos);
+    }
+
+private:
+    double lap(unsigned int stage, double start) {
+        const double now = WallTime();
+        _stageTime[stage] += now - start;
+        return now;
+    }
+
+    StandaloneHistograms _histos;
+    JetChargeObservables _observables;
+    FastJets _jets;
+    FastJets* _camJets;
+    Particle _boson;
+    ParticleVector _remaining;
+    double _stageTime[4];
+};
+
+/// The event loop of MC_GENSTUDY_JET_SUBSTRUCTURE on plain particles
+class SubstructureRun {
+public:
+    explicit SubstructureRun(const WeightStreams& streams)
+        : _histos("/MC_GENSTUDY_JET_SUBSTRUCTURE", streams),
+          _jets(FinalState(-4.0, 4.0, 0*GeV), FastJets::ANTIKT, 1.2), _camJets(0) {
+        _observables.book(_histos);
+        if (_observables.radii().enabled())
+            _camJets = new FastJets(FinalState(-4.0, 4.0, 0*GeV), FastJets::CAM, _observables.radii().maxRadius());
+    }
+    ~SubstructureRun() { delete _camJets; }
+
+    void analyze(const ParticleVector& finalState, const EventWeights& weight) {
+        SelectEta(finalState, 4.0, _fs);
+        if (_observables.preVeto(_fs, weight)) return;
+        {
+            JETSTUDY_TIME_N("MC_GENSTUDY_JET_SUBSTRUCTURE", "clustering", _fs.size());
+            _jets.calc(_fs);
+            if (_camJets) _camJets->calc(_fs);
+        }
+        _observables.analyze(_jets, _camJets, weight);
+    }
+
+    void finalize(std::vector<HistoStore::Histogram>& histos) {
+        _observables.print(std::cout, "MC_GENSTUDY_JET_SUBSTRUCTURE");
+        _observables.finalize(_histos);
+        _observables.moments().report("MC_GENSTUDY_JET_SUBSTRUCTURE");
+        JETSTUDY_REPORT("MC_GENSTUDY_JET_SUBSTRUCTURE", _observables.cutFlow());
+        _histos.collect(histos);
+    }
+
+private:
+    StandaloneHistograms _histos;
+    SubstructureObservables _observables;
+    FastJets _jets;
+    FastJets* _camJets;
+    ParticleVector _fs;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    bool jetCharge = false, substructure = false;
+    long maxEvents = -1;
+    int opt;
+    const char* pileupFile = 0;
+    const char* timingFile = 0;
+    std::vector<unsigned int> pileup(1, 10);
+    while ((opt = getopt(argc, argv, "a:n:p:k:t:")) != -1) {
+        switch (opt) {
+        case 'a':
+            if (std::strcmp(optarg, "MC_GENSTUDY_JETCHARGE") == 0) jetCharge = true;
+            else if (std::strcmp(optarg, "MC_GENSTUDY_JET_SUBSTRUCTURE") == 0) substructure = true;
+            else {
+                std::cerr << "Unknown analysis " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'n': maxEvents = std::atol(optarg); break;
+        case 'p': pileupFile = optarg; break;
+        case 'k': {
+            pileup.clear();
+            char* k = optarg;
+            while (*k) {
+                pileup.push_back(std::strtoul(k, &k, 10));
+                if (*k == ',') k++;
+                else if (*k) break;
+            }
+            if (pileup.empty() || *k) {
+                std::cerr << "Bad pile-up list " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        }
+        case 't': timingFile = optarg; break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-a analysis] [-n events] [-p pileup.jcev [-k k,...]]"
+                      << " [-t timing.csv] [in.jcev] [out.aida]" << std::endl;
+            return 1;
+        }
+    }
+    if (argc - optind != 2) {
+        std::cerr << "Usage: " << argv[0] << " [-a analysis] [-n events] [-p pileup.jcev [-k k,...]]"
+                  << " [-t timing.csv] [in.jcev] [out.aida]" << std::endl;
+        return 1;
+    }
+    if (!jetCharge && !substructure) jetCharge = substructure = true;
+
+    const double start = WallTime();
+    EventStore::Reader reader;
+    if (!reader.open(argv[optind])) return 1;
+    PileupOverlay overlay;
+    if (pileupFile && !overlay.open(pileupFile)) return 1;
+    FILE* timing = 0;
+    if (timingFile) {
+        timing = std::fopen(timingFile, "w");
+        if (!timing) {
+            std::cerr << "Cannot write " << timingFile << std::endl;
+            return 1;
+        }
+        std::fprintf(timing, "event,pileup,multiplicity,partons,jetcharge_ms,substructure_ms\n");
+    }
+    WeightStreams streams;
+    streams.configure();
+    JetChargeRun* jetChargeRun = jetCharge ? new JetChargeRun(streams) : 0;
+    SubstructureRun* substructureRun = substructure ? new SubstructureRun(streams) : 0;
+    const double setup = WallTime() - start;
+
+    uint64_t nEvents = reader.size();
+    if (maxEvents >= 0 && static_cast<uint64_t>(maxEvents) < nEvents) nEvents = maxEvents;
+    EventStore::EventView view;
+    ParticleVector finalState, partons;
+    EventWeights weight;
+    // Per pile-up level: events, multiplicity and seconds of each analysis
+    std::map<unsigned int, std::vector<double> > scaling;
+    for (uint64_t i = 0; i < nEvents; i++) {
+        if (!reader.event(i, view)) return 1;
+        // Scratch buffers of the previous event are released in one go
+        ScratchArena::local().reset();
+        ReadParticles(view, finalState, partons);
+        const unsigned int k = overlay.isOpen() ? pileup[i % pileup.size()] : 0;
+        if (k > 0 && !overlay.overlay(k, finalState, partons)) return 1;
+        streams.weights(view.weights, view.nWeights, reader.weightNames(), weight);
+        const uint64_t t0 = Instrumentation::Now();
+        if (jetChargeRun) jetChargeRun->analyze(finalState, partons, weight);
+        const uint64_t t1 = Instrumentation::Now();
+        if (substructureRun) substructureRun->analyze(finalState, weight);
+        const uint64_t t2 = Instrumentation::Now();
+        if (timing)
+            std::fprintf(timing, "%lu,%u,%lu,%lu,%.4f,%.4f\n", static_cast<unsigned long>(i), k,
+                         static_cast<unsigned long>(finalState.size()), static_cast<unsigned long>(partons.size()),
+                         1e-6*(t1 - t0), 1e-6*(t2 - t1));
+        std::vector<double>& level = scaling[k];
+        level.resize(4, 0.);
+        level[0] += 1;
+        level[1] += finalState.size();
+        level[2] += 1e-9*(t1 - t0);
+        level[3] += 1e-9*(t2 - t1);
+    }
+    const double loop = WallTime() - start - setup;
+    if (timing) std::fclose(timing);
+    if (overlay.isOpen()) {
+        std::cout << "| pile-up | events | mean multiplicity | JETCHARGE ms/event | SUBSTRUCTURE ms/event |" << std::endl;
+        for (std::map<unsigned int, std::vector<double> >::const_iterator it = scaling.begin();
+             it != scaling.end(); ++it) {
+            const std::vector<double>& level = it->second;
+            std::cout << "| " << it->first << " | " << level[0] << " | " << level[1]/level[0] << " | "
+                      << 1e3*level[2]/level[0] << " | " << 1e3*level[3]/level[0] << " |" << std::endl;
+        }
+    }
+
+    std::vector<HistoStore::Histogram> histos;
+    if (jetChargeRun) jetChargeRun->finalize(histos);
+    if (substructureRun) substructureRun->finalize(histos);
+    delete jetChargeRun;
+    delete substructureRun;
+    if (!HistoStore::WriteAIDA(argv[optind + 1], histos)) return 1;
+    std::cout << "Analysed " << nEvents << " events in " << loop << " s (setup "
+              << 1e3*setup << " ms), wrote " << argv[optind + 1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,41 @@
+/// Merge the moments files of several jobs into one.
+/// Usage: momentsmerge [-o merged.moments.json] [job.moments.json ...]
+///
+/// The files are merged in the order given, quantity by quantity in name
+/// order, so the same inputs always give the same result to the last bit.
+/// Without -o the merged moments are only printed.
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "RunningMoments.h"
+
+int main(int argc, char* argv[]) {
+    std::string outName;
+    int first = 1;
+    if (argc > 2 && std::strcmp(argv[1], "-o") == 0) {
+        outName = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [-o merged.moments.json] [job.moments.json ...]" << std::endl;
+        return 1;
+    }
+    Rivet::MomentSet merged;
+    std::string analysis;
+    for (int i = first; i < argc; i++) {
+        Rivet::MomentSet job;
+        std::string jobAnalysis;
+        if (!job.read(argv[i], jobAnalysis)) return 1;
+        if (analysis.empty()) analysis = jobAnalysis;
+        if (jobAnalysis != analysis) {
+            std::cerr << argv[i] << " belongs to " << jobAnalysis << ", not " << analysis << std::endl;
+            return 1;
+        }
+        merged.merge(job);
+    }
+    std::cout << analysis << ", " << argc - first << " files" << std::endl;
+    merged.print(std::cout);
+    if (!outName.empty() && !merged.write(outName, analysis)) return 1;
+    return 0;
+}
@@ -0,0 +1,57 @@
+#!/bin/bash
+# Cross-check of jetstudyrun against the Rivet plugins: both run over the
+# same events of the validation samples and every histogram of the plugin
+# output must be reproduced.
+#
+#   crosscheck.sh [sample.hepmc.gz ...]   default: the samples in validation/data
+#
+# Each sample is converted to jcev and back, so Rivet sees exactly the
+# particles jetstudyrun reads. The outputs agree bin by bin unless the W
+# finders disagree on an event; CROSSCHECK_MAXPULL and CROSSCHECK_MAXCHI2
+# (default 1 and 0.1) bound how much. JETSTUDY_* options are passed on to both.
+VALIDATION_DIR=$(cd $(dirname $0) && pwd)
+ANALYSIS_DIR=$(dirname ${VALIDATION_DIR})
+DATA_DIR=${VALIDATION_DIR}/data
+ANALYSES="MC_GENSTUDY_JETCHARGE MC_GENSTUDY_JET_SUBSTRUCTURE"
+
+SAMPLES="$@"
+[ -z "${SAMPLES}" ] && SAMPLES=$(ls ${DATA_DIR}/*.hepmc.gz 2> /dev/null)
+if [ -z "${SAMPLES}" ]; then
+    echo "No samples in ${DATA_DIR}, run validate.sh --generate first"
+    exit 1
+fi
+
+unset JETSTUDY_CHECKPOINT JETSTUDY_CONVERGENCE_HISTOS JETSTUDY_CONVERGENCE_STOPFILE
+export LD_LIBRARY_PATH=${ANALYSIS_DIR}:${LD_LIBRARY_PATH}
+WORK_DIR=$(mktemp -d /tmp/jetstudy_crosscheck.XXXXXX)
+trap "rm -rf ${WORK_DIR}" EXIT
+
+FAILED=""
+for sample in ${SAMPLES}; do
+    name=$(basename ${sample} .hepmc.gz)
+    gunzip -c ${sample} > ${WORK_DIR}/${name}.hepmc
+    ${ANALYSIS_DIR}/jcevconvert ${WORK_DIR}/${name}.hepmc ${WORK_DIR}/${name}.jcev > /dev/null || exit 1
+    ${ANALYSIS_DIR}/jcevconvert ${WORK_DIR}/${name}.jcev ${WORK_DIR}/${name}.replay.hepmc > /dev/null || exit 1
+
+    echo "Rivet over ${name}"
+    RIVET_START=$(date +%s.%N)
+    rivet --analysis-path=${ANALYSIS_DIR} $(for a in ${ANALYSES}; do echo -a ${a}; done) \
+        --histo-file=${WORK_DIR}/${name}.rivet.aida ${WORK_DIR}/${name}.replay.hepmc \
+        > ${WORK_DIR}/${name}.rivet.log 2>&1 || { tail -20 ${WORK_DIR}/${name}.rivet.log; exit 1; }
+    RIVET_END=$(date +%s.%N)
+    echo "jetstudyrun over ${name}"
+    ${ANALYSIS_DIR}/jetstudyrun ${WORK_DIR}/${name}.jcev ${WORK_DIR}/${name}.run.aida \
+        > ${WORK_DIR}/${name}.run.log 2>&1 || { tail -20 ${WORK_DIR}/${name}.run.log; exit 1; }
+    RUN_END=$(date +%s.%N)
+    echo "  rivet $(echo "${RIVET_END} - ${RIVET_START}" | bc) s, jetstudyrun $(echo "${RUN_END} - ${RIVET_END}" | bc) s"
+
+    ${ANALYSIS_DIR}/aidacompare -p ${CROSSCHECK_MAXPULL:-1} -c ${CROSSCHECK_MAXCHI2:-0.1} \
+        ${WORK_DIR}/${name}.rivet.aida ${WORK_DIR}/${name}.run.aida || FAILED="${FAILED} ${name}"
+done
+
+if [ -n "${FAILED}" ]; then
+    echo "Cross-check failed for${FAILED}"
+    exit 1
+fi
+echo "Cross-check passed"
+exit 0
@@ -0,0 +1,119 @@
+#!/bin/bash
+# Golden-output check: run both analyses over the checked in samples and
+# compare every histogram with the reference output, bin by bin.
+#
+#   validate.sh             compare against validation/reference
+#   validate.sh --bless     replace the reference with this build's output
+#   validate.sh --bless-baseline [rev]
+#                           bless the reference from revision rev (default
+#                           the baseline before the optimisation series),
+#                           built in a temporary git worktree
+#   validate.sh --generate  regenerate the samples (needs Pythia 8 and
+#                           MonteCarloParams/Pythia8/runPythia)
+#
+# Runs entirely locally. Tolerances can be set with VALIDATE_MAXPULL and
+# VALIDATE_MAXCHI2, see src/aidacompare.cxx. JETSTUDY_* options other than
+# checkpointing and convergence stops are passed on, so an optional mode
+# (e.g. JETSTUDY_SUBSTRUCTURE_THIN_BUDGET=0.05) can be validated against the
+# default reference.
+VALIDATION_DIR=$(cd $(dirname $0) && pwd)
+ANALYSIS_DIR=$(dirname ${VALIDATION_DIR})
+DATA_DIR=${VALIDATION_DIR}/data
+REFERENCE_DIR=${VALIDATION_DIR}/reference
+SEED=20130
+TUNE=5
+# analysis:sample pairs
+RUNS="MC_GENSTUDY_JETCHARGE:wJet MC_GENSTUDY_JET_SUBSTRUCTURE:hardQCD"
+# last revision before the optimisation series; the first reference has to
+# come from here, otherwise output changes made by the series itself are
+# blessed along with it
+BASELINE_REV=1679206
+
+MODE=compare
+BLESS_REV=""
+case "$1" in
+    --bless) MODE=bless ;;
+    --bless-baseline) MODE=bless; BLESS_REV=${2:-${BASELINE_REV}} ;;
+    --generate) MODE=generate ;;
+    "") ;;
+    *) echo "Usage: $0 [--bless|--bless-baseline [rev]|--generate]"; exit 1 ;;
+esac
+
+if [ ${MODE} = generate ]; then
+    RUNPYTHIA=${ANALYSIS_DIR}/MonteCarloParams/Pythia8/runPythia
+    if [ ! -x ${RUNPYTHIA} ]; then
+        echo "Build ${RUNPYTHIA} first (make -C MonteCarloParams/Pythia8)"
+        exit 1
+    fi
+    for sample in wJet hardQCD; do
+        ${RUNPYTHIA} ${VALIDATION_DIR}/${sample}.cnf ${DATA_DIR}/${sample}.hepmc ${SEED} ${TUNE} > ${DATA_DIR}/${sample}.log || exit 1
+        gzip -f -9 ${DATA_DIR}/${sample}.hepmc
+    done
+    echo "Samples written to ${DATA_DIR}, bless a new reference next"
+    exit 0
+fi
+
+# the reference must not depend on where a previous run stopped
+unset JETSTUDY_CHECKPOINT JETSTUDY_CONVERGENCE_HISTOS JETSTUDY_CONVERGENCE_STOPFILE
+WORK_DIR=$(mktemp -d /tmp/jetstudy_validate.XXXXXX)
+trap "rm -rf ${WORK_DIR}" EXIT
+
+if [ ${MODE} = compare ] && [ ! -f ${REFERENCE_DIR}/BLESSED_FROM ]; then
+    echo "No reference in ${REFERENCE_DIR}, the harness is not armed yet:"
+    echo "run $0 --generate and $0 --bless-baseline once and check in data/ and reference/"
+    exit 1
+fi
+
+# plugins to run: this build, or the blessed revision built on the side
+PLUGIN_DIR=${ANALYSIS_DIR}
+if [ -n "${BLESS_REV}" ]; then
+    PLUGIN_DIR=${WORK_DIR}/tree
+    git -C ${ANALYSIS_DIR} worktree add --detach ${PLUGIN_DIR} ${BLESS_REV} > /dev/null || exit 1
+    trap "git -C ${ANALYSIS_DIR} worktree remove --force ${PLUGIN_DIR}; rm -rf ${WORK_DIR}" EXIT
+    echo "Building ${BLESS_REV} in ${PLUGIN_DIR}"
+    make -C ${PLUGIN_DIR} rivet-lib > ${WORK_DIR}/build.log 2>&1 || { tail -20 ${WORK_DIR}/build.log; exit 1; }
+    # older revisions do not build every plugin from the Makefile
+    for run in ${RUNS}; do
+        analysis=${run%%:*}
+        [ -f ${PLUGIN_DIR}/Rivet${analysis}.so ] && continue
+        (cd ${PLUGIN_DIR} && g++ -shared -fPIC -m64 -O2 -Iinclude -I$(rivet-config --includedir) \
+            -o Rivet${analysis}.so ${analysis}.cc -lBOOSTFastJets -L ./ $(rivet-config --ldflags)) || exit 1
+    done
+fi
+export LD_LIBRARY_PATH=${PLUGIN_DIR}:${LD_LIBRARY_PATH}
+
+FAILED=""
+for run in ${RUNS}; do
+    analysis=${run%%:*}
+    sample=${run##*:}
+    if [ ! -f ${DATA_DIR}/${sample}.hepmc.gz ]; then
+        echo "Missing ${DATA_DIR}/${sample}.hepmc.gz, run $0 --generate once and check it in"
+        exit 1
+    fi
+    gunzip -c ${DATA_DIR}/${sample}.hepmc.gz > ${WORK_DIR}/${sample}.hepmc
+    echo "Running ${analysis} over ${sample}"
+    rivet --analysis-path=${PLUGIN_DIR} -a ${analysis} --histo-file=${WORK_DIR}/${analysis}.aida \
+        ${WORK_DIR}/${sample}.hepmc > ${WORK_DIR}/${analysis}.log 2>&1
+    if [ $? -ne 0 ]; then
+        tail -20 ${WORK_DIR}/${analysis}.log
+        FAILED="${FAILED} ${analysis}"
+        continue
+    fi
+    if [ ${MODE} = bless ]; then
+        cp ${WORK_DIR}/${analysis}.aida ${REFERENCE_DIR}/${analysis}.aida
+        echo "Blessed ${REFERENCE_DIR}/${analysis}.aida"
+        continue
+    fi
+    ${ANALYSIS_DIR}/aidacompare -p ${VALIDATE_MAXPULL:-5} -c ${VALIDATE_MAXCHI2:-3} \
+        ${REFERENCE_DIR}/${analysis}.aida ${WORK_DIR}/${analysis}.aida || FAILED="${FAILED} ${analysis}"
+done
+
+if [ -n "${FAILED}" ]; then
+    echo "Validation failed for${FAILED}"
+    exit 1
+fi
+if [ ${MODE} = bless ]; then
+    (cd ${PLUGIN_DIR} && git rev-parse HEAD) > ${REFERENCE_DIR}/BLESSED_FROM
+fi
+[ ${MODE} = compare ] && echo "Validation passed"
+exit 0